@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+   AnimationScheduler.h
+
+   Display-synced replacement for a free-running juce::Timer. Frames are
+   delivered on the component's vertical blank, only while something is
+   animating; once idle the VBlankAttachment is dropped so a stopped player
+   causes no wakeups at all.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class AnimationScheduler  : private juce::AsyncUpdater
+{
+public:
+    /** onFrame receives the current time in milliseconds (hi-res counter). */
+    AnimationScheduler (juce::Component& componentToSyncWith, std::function<void (double)> onFrame)
+        : component (componentToSyncWith), frameCallback (std::move (onFrame))
+    {
+    }
+
+    ~AnimationScheduler() override
+    {
+        cancelPendingUpdate();
+    }
+
+    /** While active, a frame is delivered on every vblank. */
+    void setActive (bool shouldBeActive)
+    {
+        active = shouldBeActive;
+
+        if (active)
+            attach();
+    }
+
+    bool isActive() const noexcept          { return active; }
+
+    /** Asks for one more frame. Any number of requests before the next vblank
+        collapse into that single frame.
+    */
+    void requestFrame()
+    {
+        framePending = true;
+        attach();
+    }
+
+private:
+    void attach()
+    {
+        cancelPendingUpdate();
+
+        if (attachment == nullptr)
+            attachment = std::make_unique<juce::VBlankAttachment> (&component, [this] { vblank(); });
+    }
+
+    void vblank()
+    {
+        if (! (active || framePending))
+        {
+            // Can't delete the attachment from inside its own callback
+            triggerAsyncUpdate();
+            return;
+        }
+
+        framePending = false;
+        frameCallback (juce::Time::getMillisecondCounterHiRes());
+    }
+
+    void handleAsyncUpdate() override
+    {
+        if (! (active || framePending))
+            attachment.reset();
+    }
+
+    juce::Component& component;
+    std::function<void (double)> frameCallback;
+    std::unique_ptr<juce::VBlankAttachment> attachment;
+    bool active = false, framePending = false;
+
+    JUCE_DECLARE_NON_COPYABLE (AnimationScheduler)
+};
@@ -47,108 +47,12 @@
 
 #pragma once
 
-class AppleTahoeLookAndFeel : public juce::LookAndFeel_V4
-{
-public:
-    AppleTahoeLookAndFeel()
-    {
-        setColour (juce::ResizableWindow::backgroundColourId, juce::Colour (0xfff9f9fb));
-
-        setColour (juce::TextButton::buttonColourId, juce::Colour (0xf3ffffff));
-        setColour (juce::TextButton::textColourOffId, juce::Colour (0xff1c1c1e));
-        setColour (juce::TextButton::textColourOnId, juce::Colour (0xff1c1c1e));
-
-        setColour (juce::Label::textColourId, juce::Colour (0xff1c1c1e));
-        setColour (juce::Label::backgroundColourId, juce::Colour (0x00ffffff));
-
-        setColour (juce::ToggleButton::textColourId, juce::Colour (0xff1c1c1e));
-
-        setColour (juce::Slider::trackColourId, juce::Colour (0xffe5e5ea));
-        setColour (juce::Slider::thumbColourId, juce::Colour (0xff007aff));
-    }
-
-    juce::Font getTextButtonFont (juce::TextButton&, int height) override
-    {
-        return juce::Font ("SF Pro Rounded", (float) height * 0.43f, juce::Font::plain);
-    }
-
-    juce::Font getLabelFont (juce::Label&) override
-    {
-        return juce::Font ("SF Pro", 14.5f, juce::Font::plain);
-    }
-
-    void drawButtonBackground (juce::Graphics& g, juce::Button& button,
-                               const juce::Colour& background,
-                               bool isHighlighted, bool isDown) override
-    {
-        auto bounds = button.getLocalBounds().toFloat();
-        const float radius = 10.0f;
-
-        auto base = background.withAlpha (isDown ? 0.85f : isHighlighted ? 0.92f : 0.88f);
-        g.setColour (base);
-        g.fillRoundedRectangle (bounds, radius);
-
-        g.setColour (juce::Colour (0x22000000));
-        g.drawRoundedRectangle (bounds, radius, 1.0f);
-
-        if (isHighlighted)
-        {
-            g.setColour (juce::Colour (0x33ffffff));
-            g.fillRoundedRectangle (bounds, radius);
-        }
-    }
-
-    void drawToggleButton (juce::Graphics& g, juce::ToggleButton& button,
-                           bool isHighlighted, bool isDown) override
-    {
-        auto bounds = button.getLocalBounds().toFloat();
-
-        float toggleWidth = 46.0f;
-        float toggleHeight = 26.0f;
-
-        juce::Rectangle<float> toggle (bounds.getX(),
-                                       bounds.getCentreY() - (toggleHeight * 0.5f),
-                                       toggleWidth,
-                                       toggleHeight);
-
-        bool on = button.getToggleState();
-
-        auto trackColour = on ? juce::Colour (0xff34c759) : juce::Colour (0xffe5e5ea);
-        auto knobColour = juce::Colours::white;
-
-        g.setColour (trackColour);
-        g.fillRoundedRectangle (toggle, toggleHeight * 0.5f);
-
-        float knobSize = toggleHeight - 4.0f;
-        float knobX = on ? (toggle.getRight() - knobSize - 2.0f)
-                         : (toggle.getX() + 2.0f);
-
-        juce::Rectangle<float> knob (knobX,
-                                     toggle.getY() + 2.0f,
-                                     knobSize,
-                                     knobSize);
-
-        g.setColour (knobColour);
-        g.fillRoundedRectangle (knob, knobSize * 0.5f);
-
-        g.setColour (juce::Colour (0x11000000));
-        g.drawRoundedRectangle (knob, knobSize * 0.5f, 1.0f);
-
-        g.setColour (juce::Colour (0xff1c1c1e));
-        g.setFont (juce::Font ("SF Pro", 15.0f, juce::Font::plain));
-        g.drawText (button.getButtonText(),
-                    toggle.getRight() + 10.0f,
-                    bounds.getY(),
-                    bounds.getWidth() - toggleWidth - 10.0f,
-                    bounds.getHeight(),
-                    juce::Justification::centredLeft);
-    }
-};
+#include "AnimationScheduler.h"
+#include "AppleTahoeLookAndFeel.h"
 
 //==============================================================================
 class MainContentComponent   : public juce::AudioAppComponent,
-                               public juce::ChangeListener,
-                               public juce::Timer
+                               public juce::ChangeListener
 {
 public:
     MainContentComponent()
@@ -191,7 +95,7 @@ public:
         transportSource.addChangeListener (this);
 
         setAudioChannels (2, 2);
-        startTimer (20);
+        animation.requestFrame();
     }
 
     ~MainContentComponent() override
@@ -253,7 +157,7 @@ public:
         }
     }
 
-    void timerCallback() override
+    void animationFrame (double)
     {
         if (transportSource.isPlaying())
         {
@@ -274,6 +178,8 @@ public:
             else
                 currentPositionLabel.setText ("Stopped", juce::dontSendNotification);
         }
+
+        animation.setActive (transportSource.isPlaying());
     }
 
     void updateLoopState (bool shouldLoop)
@@ -284,6 +190,7 @@ public:
 
 private:
     AppleTahoeLookAndFeel tahoeTheme;
+    AnimationScheduler animation { *this, [this] (double nowMs) { animationFrame (nowMs); } };
 
     enum TransportState
     {
@@ -330,6 +237,8 @@ private:
                     transportSource.stop();
                     break;
             }
+
+            animation.requestFrame();
         }
     }
 
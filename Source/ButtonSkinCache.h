@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+   ButtonSkinCache.h
+
+   Nine-slice cache for a LookAndFeel's button background. Each combination
+   of colour, state and display scale is rasterised once into a small image.
+   A button of any size is then drawn with nine image blits: corners 1:1,
+   edges and centre stretched. This replaces re-running the vector path on
+   every paint.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class ButtonSkinCache
+{
+public:
+    enum class State { normal, hover, down, disabled };
+
+    /** Paints the vector version of the skin into the given bounds. */
+    using Painter = std::function<void (juce::Graphics&, juce::Rectangle<float>, juce::Colour, State)>;
+
+    /** cornerSize: how far from each edge (in logical pixels) the skin has
+        detail that must not be stretched, e.g. a corner radius or bevel.
+    */
+    ButtonSkinCache (int cornerSize, Painter painterToUse)
+        : corner (cornerSize), painter (std::move (painterToUse))
+    {
+    }
+
+    static State getState (const juce::Button& button, bool isHighlighted, bool isDown) noexcept
+    {
+        if (! button.isEnabled())   return State::disabled;
+        if (isDown)                 return State::down;
+        if (isHighlighted)          return State::hover;
+
+        return State::normal;
+    }
+
+    /** Message thread. Falls back to the vector painter when the button is
+        too small to hold two corners; exactly two (a pill) is fine.
+    */
+    void draw (juce::Graphics& g, juce::Rectangle<int> bounds, juce::Colour colour, State state)
+    {
+        if (bounds.getWidth() < 2 * corner || bounds.getHeight() < 2 * corner)
+        {
+            painter (g, bounds.toFloat(), colour, state);
+            return;
+        }
+
+        const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const auto& image = getSkin (colour, state, scale);
+        const auto sourceCorner = (image.getWidth() - centreSize) / 2;
+
+        const int dx[] { bounds.getX(), bounds.getX() + corner, bounds.getRight() - corner, bounds.getRight() };
+        const int dy[] { bounds.getY(), bounds.getY() + corner, bounds.getBottom() - corner, bounds.getBottom() };
+        const int sx[] { 0, sourceCorner, sourceCorner + centreSize, image.getWidth() };
+
+        const juce::Graphics::ScopedSaveState save (g);
+        g.setImageResamplingQuality (juce::Graphics::lowResamplingQuality); // the edges are uniform
+
+        for (int row = 0; row < 3; ++row)
+            for (int column = 0; column < 3; ++column)
+                g.drawImage (image,
+                             dx[column], dy[row], dx[column + 1] - dx[column], dy[row + 1] - dy[row],
+                             sx[column], sx[row], sx[column + 1] - sx[column], sx[row + 1] - sx[row]);
+    }
+
+private:
+    static constexpr int centreSize = 2;    // physical pixels between the corners
+    static constexpr size_t maxSkins = 64;  // colour animations shouldn't grow it forever
+
+    const juce::Image& getSkin (juce::Colour colour, State state, float scale)
+    {
+        const auto key = (juce::uint64) colour.getARGB()
+                       | ((juce::uint64) state << 32)
+                       | ((juce::uint64) juce::roundToInt (scale * 100.0f) << 34);
+
+        if (auto found = skins.find (key); found != skins.end())
+            return found->second;
+
+        if (skins.size() >= maxSkins)
+            skins.clear();
+
+        // Whole physical pixels per corner, so corners blit 1:1
+        const auto sourceCorner = (int) std::ceil ((float) corner * scale);
+        const auto size = 2 * sourceCorner + centreSize;
+
+        juce::Image image (juce::Image::ARGB, size, size, true);
+
+        {
+            juce::Graphics g (image);
+            g.addTransform (juce::AffineTransform::scale (scale));
+            painter (g, { (float) size / scale, (float) size / scale }, colour, state);
+        }
+
+        return skins[key] = image;
+    }
+
+    const int corner;
+    Painter painter;
+    std::unordered_map<juce::uint64, juce::Image> skins;
+
+    JUCE_DECLARE_NON_COPYABLE (ButtonSkinCache)
+};
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+   ChannelRouter.h
+
+   Maps the file's channels onto the device's outputs through a gain matrix
+   (up to 64 x 64). Every non-zero cell is one vectorised multiply-add over
+   the block, so a sparse map such as the identity costs one copy per output.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LockFreeExchange.h"
+
+class ChannelRouter
+{
+public:
+    static constexpr int maxChannels = 64;
+
+    struct Matrix
+    {
+        std::array<std::array<float, maxChannels>, maxChannels> gains {}; // [output][input]
+        int numInputs = 0, numOutputs = 0;
+
+        /** Identity when the layouts match, the ITU-R BS.775 fold-down for 5.1
+            to stereo, mono spread over the first two outputs, and otherwise
+            input i folded onto output i % numOutputs with equal-power gain.
+        */
+        static Matrix createDefault (int numInputs, int numOutputs)
+        {
+            Matrix m;
+            m.numInputs  = juce::jlimit (0, maxChannels, numInputs);
+            m.numOutputs = juce::jlimit (0, maxChannels, numOutputs);
+
+            if (m.numInputs == 0 || m.numOutputs == 0)
+                return m;
+
+            const auto minus3dB = juce::MathConstants<float>::sqrt2 * 0.5f;
+
+            if (m.numInputs == 1)
+            {
+                for (int out = 0; out < juce::jmin (2, m.numOutputs); ++out)
+                    m.gains[(size_t) out][0] = 1.0f;
+            }
+            else if (m.numInputs == 6 && m.numOutputs == 2)
+            {
+                // WAV order: L R C LFE Ls Rs; the LFE is dropped
+                m.gains[0][0] = 1.0f;  m.gains[0][2] = minus3dB;  m.gains[0][4] = minus3dB;
+                m.gains[1][1] = 1.0f;  m.gains[1][2] = minus3dB;  m.gains[1][5] = minus3dB;
+            }
+            else
+            {
+                std::array<int, maxChannels> fanIn {};
+
+                for (int in = 0; in < m.numInputs; ++in)
+                    ++fanIn[(size_t) (in % m.numOutputs)];
+
+                for (int in = 0; in < m.numInputs; ++in)
+                {
+                    const auto out = in % m.numOutputs;
+                    m.gains[(size_t) out][(size_t) in] = 1.0f / std::sqrt ((float) fanIn[(size_t) out]);
+                }
+            }
+
+            return m;
+        }
+    };
+
+    ChannelRouter()
+    {
+        active = Matrix::createDefault (2, 2);
+    }
+
+    /** Any thread but the audio one; the audio thread picks it up next block. */
+    void setMatrix (const Matrix& newMatrix)
+    {
+        const juce::ScopedLock sl (writerLock);
+        pending.write (newMatrix);
+    }
+
+    /** Audio thread: mixes numSamples of source into dest, starting at
+        destStartSample. dest channels beyond the matrix are cleared.
+    */
+    void process (const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest,
+                  int destStartSample, int numSamples) noexcept
+    {
+        if (auto* newMatrix = pending.readIfNew())
+            active = *newMatrix;
+
+        const auto numIn  = juce::jmin (active.numInputs, source.getNumChannels());
+        const auto numOut = dest.getNumChannels();
+
+        for (int out = 0; out < numOut; ++out)
+        {
+            auto* dst = dest.getWritePointer (out, destStartSample);
+            bool written = false;
+
+            if (out < active.numOutputs)
+            {
+                const auto& row = active.gains[(size_t) out];
+
+                for (int in = 0; in < numIn; ++in)
+                {
+                    const auto gain = row[(size_t) in];
+
+                    if (gain == 0.0f)
+                        continue;
+
+                    if (written)
+                        juce::FloatVectorOperations::addWithMultiply (dst, source.getReadPointer (in), gain, numSamples);
+                    else
+                        juce::FloatVectorOperations::copyWithMultiply (dst, source.getReadPointer (in), gain, numSamples);
+
+                    written = true;
+                }
+            }
+
+            if (! written)
+                juce::FloatVectorOperations::clear (dst, numSamples);
+        }
+    }
+
+private:
+    Matrix active;
+    TripleBuffer<Matrix> pending;
+    juce::CriticalSection writerLock; // keeps TripleBuffer single-writer
+
+    JUCE_DECLARE_NON_COPYABLE (ChannelRouter)
+};
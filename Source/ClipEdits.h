@@ -0,0 +1,347 @@
+/*
+  ==============================================================================
+
+   ClipEdits.h
+
+   Non-destructive trim, split and fade of the loaded file.
+
+   An edit never touches the file or copies its audio. The edited clip is a
+   list of segments, each one a range of the source file placed on the
+   clip's timeline. The list is immutable once published. An edit builds a
+   new list from the old one: segments it doesn't change keep their fade
+   caches by shared pointer, so an edit costs a few segments' worth of
+   memory whatever the file's size.
+
+   Only faded audio is computed ahead. A fade is rendered once into a cache
+   the length of the fade, when it's set. Everything else is read straight
+   from the file by ClipEditReader, which is what the player's reader
+   source pulls from.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LockFreeExchange.h"
+
+struct ClipSegment
+{
+    juce::int64 start = 0;          // on the clip's timeline
+    juce::int64 sourceStart = 0;    // in the file
+    juce::int64 length = 0;
+
+    int fadeInLength = 0, fadeOutLength = 0;
+
+    /** The faded samples (fadeInLength or fadeOutLength of them), or nullptr. */
+    std::shared_ptr<const juce::AudioBuffer<float>> fadeIn, fadeOut;
+
+    juce::int64 getEnd() const noexcept     { return start + length; }
+};
+
+/** One published state of the clip. Never modified once shared. */
+struct ClipEditList
+{
+    std::vector<ClipSegment> segments;
+
+    juce::int64 getLength() const noexcept
+    {
+        return segments.empty() ? 0 : segments.back().getEnd();
+    }
+
+    /** The segment that plays at this position on the timeline, or nullptr. */
+    const ClipSegment* find (juce::int64 position) const noexcept
+    {
+        auto it = std::upper_bound (segments.begin(), segments.end(), position,
+                                    [] (juce::int64 p, const ClipSegment& s) { return p < s.start; });
+
+        if (it == segments.begin())
+            return nullptr;
+
+        --it;
+        return position < it->getEnd() ? &*it : nullptr;
+    }
+};
+
+//==============================================================================
+/** Plays the source file through the current edit list. Owns the source
+    reader. Meant for a single reading thread at a time (the audio thread, or
+    the read-ahead thread), as AudioFormatReaderSource uses it.
+*/
+class ClipEditReader  : public juce::AudioFormatReader
+{
+public:
+    static constexpr int maxChannels = 64;
+
+    explicit ClipEditReader (std::unique_ptr<juce::AudioFormatReader> sourceReader)
+        : juce::AudioFormatReader (nullptr, sourceReader->getFormatName()),
+          source (std::move (sourceReader))
+    {
+        sampleRate            = source->sampleRate;
+        bitsPerSample         = 32;
+        lengthInSamples       = source->lengthInSamples;
+        numChannels           = (unsigned int) juce::jmin (maxChannels, (int) source->numChannels);
+        usesFloatingPointData = true;
+        metadataValues        = source->metadataValues;
+
+        auto whole = std::make_shared<ClipEditList>();
+        whole->segments.push_back ({ 0, 0, lengthInSamples });
+        setEdits (whole);
+    }
+
+    /** Message thread. The reader picks the new list up on its next read. */
+    void setEdits (std::shared_ptr<const ClipEditList> newEdits)
+    {
+        // Read unsynchronised by AudioFormatReaderSource, like a file that grows
+        lengthInSamples = newEdits->getLength();
+
+        // The old list is released here, when its slot is reused, never on the reader's thread
+        pending.write (std::move (newEdits));
+    }
+
+    bool readSamples (int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                      juce::int64 startSampleInFile, int numSamples) override
+    {
+        if (auto* newest = pending.readIfNew())
+            edits = newest->get();
+
+        numDestChannels = juce::jmin (numDestChannels, maxChannels);
+
+        std::array<float*, maxChannels> dest {};
+
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            if (destChannels[ch] != nullptr)
+                dest[(size_t) ch] = reinterpret_cast<float*> (destChannels[ch]) + startOffsetInDestBuffer;
+
+        while (numSamples > 0)
+        {
+            const auto* segment = edits != nullptr ? edits->find (startSampleInFile) : nullptr;
+
+            if (segment == nullptr)
+            {
+                // Past the end (segments are contiguous, there are no gaps)
+                for (int ch = 0; ch < numDestChannels; ++ch)
+                    if (dest[(size_t) ch] != nullptr)
+                        juce::FloatVectorOperations::clear (dest[(size_t) ch], numSamples);
+
+                break;
+            }
+
+            const auto offset = startSampleInFile - segment->start;
+            const auto fadeOutStart = segment->length - segment->fadeOutLength;
+            auto num = (int) juce::jmin ((juce::int64) numSamples, segment->length - offset);
+
+            if (offset < segment->fadeInLength && segment->fadeIn != nullptr)
+            {
+                num = juce::jmin (num, segment->fadeInLength - (int) offset);
+                copyFromCache (*segment->fadeIn, (int) offset, dest, numDestChannels, num);
+            }
+            else if (offset >= fadeOutStart && segment->fadeOut != nullptr)
+            {
+                copyFromCache (*segment->fadeOut, (int) (offset - fadeOutStart), dest, numDestChannels, num);
+            }
+            else
+            {
+                num = (int) juce::jmin ((juce::int64) num, fadeOutStart - offset);
+                source->read (dest.data(), numDestChannels, segment->sourceStart + offset, num);
+            }
+
+            advance (dest, numDestChannels, num);
+            startSampleInFile += num;
+            numSamples -= num;
+        }
+
+        return true;
+    }
+
+private:
+    static void advance (std::array<float*, maxChannels>& dest, int numDestChannels, int numSamples) noexcept
+    {
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            if (dest[(size_t) ch] != nullptr)
+                dest[(size_t) ch] += numSamples;
+    }
+
+    static void copyFromCache (const juce::AudioBuffer<float>& cache, int cacheOffset,
+                               std::array<float*, maxChannels>& dest, int numDestChannels, int numSamples) noexcept
+    {
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            if (dest[(size_t) ch] != nullptr)
+                juce::FloatVectorOperations::copy (dest[(size_t) ch],
+                                                   cache.getReadPointer (juce::jmin (ch, cache.getNumChannels() - 1), cacheOffset),
+                                                   numSamples);
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> source;
+    TripleBuffer<std::shared_ptr<const ClipEditList>> pending;
+    const ClipEditList* edits = nullptr; // owned by a slot of pending
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipEditReader)
+};
+
+//==============================================================================
+/** The editing side, on the message thread. Positions are in samples on the
+    clip's timeline (what the transport plays), after any earlier edits.
+*/
+class ClipEditor
+{
+public:
+    static constexpr double maxFadeSeconds = 10.0;
+
+    /** Message thread. Starts over with the whole file as one segment.
+        cacheReader is a second reader of the same file, used here to render
+        fades while the player's reader is busy on the audio thread.
+    */
+    void attach (ClipEditReader* playbackReader, std::unique_ptr<juce::AudioFormatReader> cacheReader)
+    {
+        target = playbackReader;
+        fadeReader = std::move (cacheReader);
+
+        auto whole = std::make_shared<ClipEditList>();
+
+        if (target != nullptr)
+            whole->segments.push_back ({ 0, 0, target->lengthInSamples });
+
+        current = whole;
+    }
+
+    std::shared_ptr<const ClipEditList> getEdits() const noexcept   { return current; }
+    double getSampleRate() const noexcept                           { return target != nullptr ? target->sampleRate : 0.0; }
+
+    /** Cuts the segment under this position in two. */
+    void split (juce::int64 position)
+    {
+        auto edits = std::make_shared<ClipEditList> (*current);
+        splitAt (*edits, position);
+        publish (std::move (edits));
+    }
+
+    /** Keeps only [newStart, newEnd) of the timeline. Does nothing and returns
+        false if that would leave nothing to play: edits aren't undoable, and
+        an empty clip could only be recovered by reloading the file.
+    */
+    bool trim (juce::int64 newStart, juce::int64 newEnd)
+    {
+        newStart = juce::jmax ((juce::int64) 0, newStart);
+        newEnd = juce::jmin (current->getLength(), newEnd);
+
+        if (newEnd <= newStart)
+            return false;
+
+        auto edits = std::make_shared<ClipEditList> (*current);
+        splitAt (*edits, newStart);
+        splitAt (*edits, newEnd);
+
+        auto& segments = edits->segments;
+        segments.erase (std::remove_if (segments.begin(), segments.end(),
+                                        [=] (const ClipSegment& s) { return s.start < newStart || s.start >= newEnd; }),
+                        segments.end());
+
+        publish (std::move (edits));
+        return true;
+    }
+
+    /** Sets the fades of the segment under this position; 0 removes one. */
+    void setFades (juce::int64 position, int fadeInSamples, int fadeOutSamples)
+    {
+        auto edits = std::make_shared<ClipEditList> (*current);
+        const auto index = indexOf (*edits, position);
+
+        if (index < 0)
+            return;
+
+        auto& segment = edits->segments[(size_t) index];
+        setFadeIn (segment, fadeInSamples);
+        setFadeOut (segment, fadeOutSamples);
+        publish (std::move (edits));
+    }
+
+private:
+    static int indexOf (const ClipEditList& edits, juce::int64 position)
+    {
+        const auto* segment = edits.find (position);
+        return segment != nullptr ? (int) (segment - edits.segments.data()) : -1;
+    }
+
+    void splitAt (ClipEditList& edits, juce::int64 position)
+    {
+        const auto index = indexOf (edits, position);
+
+        if (index < 0 || edits.segments[(size_t) index].start == position)
+            return;
+
+        auto left = edits.segments[(size_t) index];
+        auto right = left;
+        const auto cut = position - left.start;
+
+        // Each half keeps the fade on its outer edge, shared as is when it still fits
+        left.length = cut;
+        setFadeOut (left, 0);
+        setFadeIn (left, left.fadeInLength);
+
+        right.start = position;
+        right.sourceStart += cut;
+        right.length -= cut;
+        setFadeIn (right, 0);
+        setFadeOut (right, right.fadeOutLength);
+
+        edits.segments[(size_t) index] = left;
+        edits.segments.insert (edits.segments.begin() + index + 1, right);
+    }
+
+    void setFadeIn (ClipSegment& segment, int length)
+    {
+        length = clampFade (segment, length);
+
+        if (length != segment.fadeInLength || (length > 0 && segment.fadeIn == nullptr))
+            segment.fadeIn = renderFade (segment.sourceStart, length, true);
+
+        segment.fadeInLength = segment.fadeIn != nullptr ? length : 0;
+    }
+
+    void setFadeOut (ClipSegment& segment, int length)
+    {
+        length = clampFade (segment, length);
+
+        if (length != segment.fadeOutLength || (length > 0 && segment.fadeOut == nullptr))
+            segment.fadeOut = renderFade (segment.sourceStart + segment.length - length, length, false);
+
+        segment.fadeOutLength = segment.fadeOut != nullptr ? length : 0;
+    }
+
+    int clampFade (const ClipSegment& segment, int length) const
+    {
+        const auto maxLength = (juce::int64) (maxFadeSeconds * getSampleRate());
+        return (int) juce::jlimit ((juce::int64) 0, juce::jmin (segment.length / 2, maxLength), (juce::int64) length);
+    }
+
+    std::shared_ptr<const juce::AudioBuffer<float>> renderFade (juce::int64 sourceStart, int length, bool fadingIn) const
+    {
+        if (length <= 0 || fadeReader == nullptr)
+            return {};
+
+        auto cache = std::make_shared<juce::AudioBuffer<float>> ((int) target->numChannels, length);
+        fadeReader->read (cache.get(), 0, length, sourceStart, true, true);
+        cache->applyGainRamp (0, length, fadingIn ? 0.0f : 1.0f, fadingIn ? 1.0f : 0.0f);
+        return cache;
+    }
+
+    void publish (std::shared_ptr<ClipEditList> edits)
+    {
+        juce::int64 start = 0;
+
+        for (auto& segment : edits->segments)
+        {
+            segment.start = start;
+            start += segment.length;
+        }
+
+        current = edits;
+
+        if (target != nullptr)
+            target->setEdits (std::move (edits));
+    }
+
+    ClipEditReader* target = nullptr; // owned by the engine's reader source
+    std::unique_ptr<juce::AudioFormatReader> fadeReader;
+    std::shared_ptr<const ClipEditList> current = std::make_shared<ClipEditList>();
+};
@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+   ControlInput.h
+
+   Stage controllers: every MIDI input, plus OSC on 127.0.0.1. Messages are
+   turned into PlayerEngine commands on the thread they arrive on and posted
+   straight to the engine's lock-free queue. The message thread only follows
+   along afterwards, to update the buttons.
+
+   MIDI:  Start / Continue or note 60 = play,  note 61 = pause,
+          Stop or note 62 = stop,  CC 7 = gain
+          In sampler mode every note goes to the sampler (or library) instead.
+   OSC:   /player/play   /player/pause   /player/stop
+          /player/seek <seconds>   /player/gain <0..1>
+
+   Each command carries its arrival time. With latency measurement on, the
+   input-to-output delay the engine records is logged once a second.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlayerEngine.h"
+
+class ControlInput  : private juce::MidiInputCallback,
+                      private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>,
+                      private juce::AsyncUpdater,
+                      private juce::Timer
+{
+public:
+    static constexpr int oscPort = 9001;
+
+    /** Message thread, after a controller changed the gain. */
+    std::function<void (float)> onGainChanged;
+
+    /** Message thread, after a MIDI note reached the sampler. */
+    std::function<void()> onNotePlayed;
+
+    explicit ControlInput (PlayerEngine& engineToControl)
+        : engine (engineToControl)
+    {
+    }
+
+    ~ControlInput() override
+    {
+        oscReceiver.removeListener (this);
+        oscReceiver.disconnect();
+
+        for (auto& input : midiInputs)
+            input->stop();
+
+        stopTimer();
+        cancelPendingUpdate();
+    }
+
+    /** Opens the MIDI devices and the OSC socket. Slow on some systems, so
+        it may run on a worker during start-up.
+    */
+    void start()
+    {
+        for (const auto& device : juce::MidiInput::getAvailableDevices())
+        {
+            if (auto input = juce::MidiInput::openDevice (device.identifier, this))
+            {
+                input->start();
+                midiInputs.push_back (std::move (input));
+            }
+        }
+
+        // Bound to the loopback interface only: nothing off this machine reaches it
+        if (oscSocket.bindToPort (oscPort, "127.0.0.1") && oscReceiver.connectToSocket (oscSocket))
+            oscReceiver.addListener (this);
+        else
+            juce::Logger::writeToLog ("[control] can't listen for OSC on 127.0.0.1:" + juce::String (oscPort));
+
+        juce::Logger::writeToLog (juce::String::formatted ("[control] %d MIDI input(s), OSC on 127.0.0.1:%d",
+                                                           (int) midiInputs.size(), oscPort));
+    }
+
+    /** Message thread. */
+    void setLatencyMeasurement (bool shouldMeasure)
+    {
+        if (shouldMeasure)
+        {
+            lastStats = engine.getLatencyStats();
+            startTimer (1000);
+        }
+        else
+        {
+            stopTimer();
+        }
+    }
+
+private:
+    using Command = PlayerEngine::Command;
+
+    //==============================================================================
+    // MIDI thread
+    void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message) override
+    {
+        const auto arrivedMs = message.getTimeStamp() * 1000.0; // same clock as getMillisecondCounterHiRes()
+
+        if (message.isMidiStart() || message.isMidiContinue())
+            dispatch (Command::Type::play, arrivedMs);
+        else if (message.isMidiStop())
+            dispatch (Command::Type::stop, arrivedMs);
+        else if (engine.isSamplerMode() && (message.isNoteOnOrOff() || message.isAllNotesOff() || message.isAllSoundOff()))
+        {
+            if (message.isNoteOn())
+            {
+                engine.noteOn (message.getNoteNumber(), message.getFloatVelocity());
+                notePlayed = true;
+                triggerAsyncUpdate();
+            }
+            else if (message.isNoteOff())
+                engine.noteOff (message.getNoteNumber());
+            else
+                engine.allNotesOff();
+        }
+        else if (message.isNoteOn())
+        {
+            switch (message.getNoteNumber())
+            {
+                case 60:    dispatch (Command::Type::play,  arrivedMs); break;
+                case 61:    dispatch (Command::Type::pause, arrivedMs); break;
+                case 62:    dispatch (Command::Type::stop,  arrivedMs); break;
+                default:    break;
+            }
+        }
+        else if (message.isControllerOfType (7))
+            setGain ((float) message.getControllerValue() / 127.0f);
+    }
+
+    // OSC receiver thread
+    void oscMessageReceived (const juce::OSCMessage& message) override
+    {
+        const auto arrivedMs = juce::Time::getMillisecondCounterHiRes();
+        const auto address = message.getAddressPattern().toString();
+        const auto firstFloat = [&message]
+        {
+            return message.size() > 0 && message[0].isFloat32() ? message[0].getFloat32()
+                 : message.size() > 0 && message[0].isInt32()   ? (float) message[0].getInt32()
+                                                                : 0.0f;
+        };
+
+        if (address == "/player/play")          dispatch (Command::Type::play,  arrivedMs);
+        else if (address == "/player/pause")    dispatch (Command::Type::pause, arrivedMs);
+        else if (address == "/player/stop")     dispatch (Command::Type::stop,  arrivedMs);
+        else if (address == "/player/seek")     dispatch (Command::Type::seek,  arrivedMs, firstFloat());
+        else if (address == "/player/gain")     setGain (firstFloat());
+    }
+
+    //==============================================================================
+    void dispatch (Command::Type type, double arrivedMs, double seconds = 0.0) noexcept
+    {
+        Command command;
+        command.type = type;
+        command.seconds = seconds;
+        command.external = true;
+        command.timestampMs = arrivedMs;
+        engine.post (command);
+    }
+
+    void setGain (float gain) noexcept
+    {
+        engine.setGain (juce::jlimit (0.0f, 1.0f, gain));
+        gainChanged = true;
+        triggerAsyncUpdate(); // the slider catches up on the message thread
+    }
+
+    void handleAsyncUpdate() override
+    {
+        if (gainChanged.exchange (false) && onGainChanged != nullptr)
+            onGainChanged (engine.getGain());
+
+        if (notePlayed.exchange (false) && onNotePlayed != nullptr)
+            onNotePlayed();
+    }
+
+    void timerCallback() override
+    {
+        const auto stats = engine.getLatencyStats();
+        const auto count = stats.count - lastStats.count;
+
+        if (count > 0)
+            juce::Logger::writeToLog (juce::String::formatted ("[latency] %d command(s): mean %.2f ms, last %.2f ms, max since start %.2f ms",
+                                                               count, (stats.totalMs - lastStats.totalMs) / count,
+                                                               stats.lastMs, stats.maxMs));
+
+        lastStats = stats;
+    }
+
+    PlayerEngine& engine;
+    std::vector<std::unique_ptr<juce::MidiInput>> midiInputs;
+    juce::DatagramSocket oscSocket { false };
+    juce::OSCReceiver oscReceiver;
+    PlayerEngine::LatencyStats lastStats;
+    std::atomic<bool> gainChanged { false }, notePlayed { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControlInput)
+};
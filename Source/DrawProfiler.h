@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+   DrawProfiler.h
+
+   Times a LookAndFeel's button routines offscreen. drawButtonBackground and
+   drawToggleButton are rendered into a software Image thousands of times
+   at several sizes and scale factors, and the mean cost of each is logged in
+   microseconds per draw.
+
+   Start the app with --profile-drawing to get the table for every skin:
+   UnixMatrix, Windows 95, Apple Tahoe and the classic Mac bevel (Old99).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "UnixMatrix.h"
+#include "Windows95LookAndFeel.h"
+#include "AppleTahoeLookAndFeel.h"
+#include "Old99LookAndFeel.h"
+
+class DrawProfiler
+{
+public:
+    static void runAllThemes (int iterations = 5000)
+    {
+        UnixMatrixLookAndFeel unixMatrix;
+        Windows95LookAndFeel windows95;
+        AppleTahoeLookAndFeel appleTahoe;
+        Old99LookAndFeel old99;
+
+        run (unixMatrix, "UnixMatrix", iterations);
+        run (windows95,  "Windows95",  iterations);
+        run (appleTahoe, "AppleTahoe", iterations);
+        run (old99,      "Old99",      iterations);
+    }
+
+    /** Lines look like:
+            [draw] UnixMatrix  drawButtonBackground   80x22  @1.5x  hover      1.84 us
+    */
+    static void run (juce::LookAndFeel& lookAndFeel, const juce::String& themeName, int iterations = 5000)
+    {
+        juce::TextButton textButton ("Play");
+        juce::ToggleButton toggleButton ("Loop");
+        textButton.setLookAndFeel (&lookAndFeel);
+        toggleButton.setLookAndFeel (&lookAndFeel);
+
+        const auto colour = lookAndFeel.findColour (juce::TextButton::buttonColourId);
+        const juce::Point<int> sizes[] { { 80, 22 }, { 280, 22 }, { 280, 44 } };
+        const float scales[] { 1.0f, 1.5f, 2.0f };
+
+        struct ButtonState { const char* name; bool hover, down; };
+        const ButtonState states[] { { "normal", false, false }, { "hover", true, false }, { "down", true, true } };
+
+        for (auto size : sizes)
+        {
+            textButton.setSize (size.x, size.y);
+            toggleButton.setSize (size.x, size.y);
+
+            for (auto scale : scales)
+            {
+                juce::Image image (juce::Image::ARGB, juce::roundToInt ((float) size.x * scale),
+                                   juce::roundToInt ((float) size.y * scale), true, juce::SoftwareImageType());
+                juce::Graphics g (image);
+                g.addTransform (juce::AffineTransform::scale (scale));
+
+                for (const auto& state : states)
+                {
+                    const auto background = timePerDraw (iterations, [&]
+                    {
+                        lookAndFeel.drawButtonBackground (g, textButton, colour, state.hover, state.down);
+                    });
+
+                    const auto toggle = timePerDraw (iterations, [&]
+                    {
+                        lookAndFeel.drawToggleButton (g, toggleButton, state.hover, state.down);
+                    });
+
+                    log (themeName, "drawButtonBackground", size, scale, state.name, background);
+                    log (themeName, "drawToggleButton", size, scale, state.name, toggle);
+                }
+            }
+        }
+
+        textButton.setLookAndFeel (nullptr);
+        toggleButton.setLookAndFeel (nullptr);
+    }
+
+private:
+    template <typename DrawFunction>
+    static double timePerDraw (int iterations, DrawFunction&& draw)
+    {
+        for (int i = 0; i < 16; ++i) // warm the glyph and path caches first
+            draw();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (int i = 0; i < iterations; ++i)
+            draw();
+
+        const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        return seconds * 1.0e6 / juce::jmax (1, iterations);
+    }
+
+    static void log (const juce::String& theme, const char* routine, juce::Point<int> size,
+                     float scale, const char* state, double microseconds)
+    {
+        juce::Logger::writeToLog (juce::String::formatted ("[draw] %-10s  %-20s %4dx%-3d @%.1fx  %-7s %8.2f us",
+                                                           theme.toRawUTF8(), routine, size.x, size.y,
+                                                           (double) scale, state, microseconds));
+    }
+};
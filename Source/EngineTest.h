@@ -0,0 +1,342 @@
+/*
+  ==============================================================================
+
+   EngineTest.h
+
+   Offline regression test of PlayerEngine, with no audio device and no
+   message loop. The engine is pumped in fixed-size blocks through a scripted
+   session on Resources/cello.wav: play, gain, EQ and speed changes, pause,
+   seek, end of file, looping and stop. dispatchPendingUpdates() runs between
+   the blocks, as the message loop would.
+
+   At each block size, the run checks:
+     - the output, bit for bit, against a second run of the same script,
+     - the state changes seen by a listener, against the expected list,
+     - silence once paused or stopped, and that the file ends when its
+       remaining length says it should,
+     - that the position never goes backwards while playing straight through,
+       and that looping carries on past the end of the file,
+     - that gain and balance scale each output by exactly what they should,
+       against a render at unity,
+     - the cost of each block, against a share of the block period.
+
+   None of it needs stored output, so it holds on any build and CPU. Any
+   failure makes the process exit with 1. Start the app with --test-engine
+   to run it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlayerEngine.h"
+
+class EngineTest  : private PlayerEngine::Listener
+{
+public:
+    static constexpr double sampleRate = 44100.0;
+
+    /** Share of the block period: over meanLoadBudget on average, or over
+        maxLoadBudget for any single block (a real device would drop out),
+        fails the run.
+    */
+    static constexpr double meanLoadBudget = 0.1, maxLoadBudget = 1.0;
+
+    /** How far a scaled output may stray from the expected multiple of the
+        unity render, relative to the unity render's peak.
+    */
+    static constexpr float maxScalingErrorDecibels = -90.0f;
+
+    /** Returns the exit code: 0 if every check passed. */
+    static int run (const juce::File& fixture)
+    {
+        if (! fixture.existsAsFile())
+        {
+            juce::Logger::writeToLog ("[test] Resources/cello.wav not found");
+            return 1;
+        }
+
+        int failures = 0;
+
+        for (auto blockSize : { 64, 256, 1024 })
+        {
+            EngineTest first (fixture, blockSize), second (fixture, blockSize);
+            first.runScript();
+            second.runScript();
+
+            first.check (first.rendered == second.rendered, "two runs of the script render the same output");
+
+            // Half gain, balance a quarter to the left: 0.5 on the left, 0.5 * 0.75 on the right
+            EngineTest unity (fixture, blockSize), scaled (fixture, blockSize);
+            unity.renderSteady (1.0f, 0.0f);
+            scaled.renderSteady (0.5f, -0.25f);
+            scaled.check (scaled.isScaledFrom (unity, { 0.5f, 0.5f * PlaybackDSP::getBalanceGain (1, 2, -0.25f) }),
+                          "gain 0.5 and balance -0.25 scale the outputs exactly");
+
+            first.checkLoad();
+            failures += first.failures + second.failures + unity.failures + scaled.failures;
+        }
+
+        juce::Logger::writeToLog (failures == 0 ? juce::String ("[test] engine: all checks passed")
+                                                : "[test] engine: " + juce::String (failures) + " check(s) failed");
+        return failures == 0 ? 0 : 1;
+    }
+
+private:
+    using State = PlayerEngine::State;
+
+    EngineTest (const juce::File& fixtureFile, int size)
+        : fixture (fixtureFile), blockSize (size)
+    {
+        formats.registerBasicFormats();
+        engine.addListener (this);
+    }
+
+    ~EngineTest() override
+    {
+        engine.removeListener (this);
+        engine.releaseResources();
+    }
+
+    void playerStateChanged (State newState) override       { states.add (newState); }
+
+    //==============================================================================
+    void runScript()
+    {
+        // No worker thread: the meters aren't part of the output
+        engine.setLoudnessMeteringEnabled (false);
+        engine.setNumOutputChannels (2);
+        engine.prepareToPlay (blockSize, sampleRate);
+
+        auto settings = engine.getDSPChain().getSettings();
+        settings.bands[1].gainDecibels = 6.0f;
+        engine.getDSPChain().setSettings (settings);
+        engine.getDSPChain().setEnabled (true);
+
+        if (! check (engine.loadFile (fixture), "load the fixture"))
+            return;
+
+        const auto length = engine.getLengthInSeconds();
+
+        // Start, then a gain change and a speed change and back
+        engine.play();
+        pump (1);
+        check (engine.getState() == State::playing, "playing after the first block");
+
+        pump (blocksFor (0.1), true);
+        engine.setGain (0.5f);
+        pump (blocksFor (0.1), true);
+        engine.setSpeed (1.5);
+        pump (blocksFor (0.15), true);
+        engine.setSpeed (1.0);
+        pump (blocksFor (0.1), true);
+
+        // Pause: one fade-out block, then silence
+        engine.pause();
+        pump (2);
+        check (lastBlockSilent, "silent while paused");
+
+        // Seek and resume; the file ends by itself, after what was left of it
+        engine.seek (length * 0.25);
+        engine.play();
+        pump (1);
+        check (engine.getState() == State::playing, "playing again after a seek");
+
+        int blocksToEnd = 1;
+
+        for (; blocksToEnd < blocksFor (length * 2.0) && engine.getState() != State::stopped; ++blocksToEnd)
+            pump (1);
+
+        check (engine.getState() == State::stopped, "stopped at the end of the file");
+        check (std::abs (blocksToEnd - blocksFor (length * 0.75)) <= 2,
+               juce::String::formatted ("the last 75 %% of the file took %d blocks, not %d",
+                                        blocksToEnd, blocksFor (length * 0.75)));
+        pump (1);
+
+        // Looping: still playing well past the end, the position having wrapped
+        engine.setLooping (true);
+        engine.play();
+
+        auto wrapped = false;
+        auto previousPosition = engine.getCurrentPosition();
+
+        for (int i = 0; i < blocksFor (length * 1.5); ++i)
+        {
+            pump (1);
+            wrapped = wrapped || engine.getCurrentPosition() < previousPosition - length * 0.5;
+            previousPosition = engine.getCurrentPosition();
+        }
+
+        check (engine.getState() == State::playing && ! lastBlockSilent, "still playing past the end when looping");
+        check (wrapped, "the position wraps when looping");
+
+        // Stop: fade out, then silence, back at the start
+        engine.stop();
+        pump (2);
+        check (lastBlockSilent, "silent once stopped");
+        check (engine.getCurrentPosition() == 0.0, "back at the start once stopped");
+
+        check (states == juce::Array<State> { State::starting, State::playing, State::paused,
+                                              State::starting, State::playing, State::stopped,
+                                              State::starting, State::playing, State::stopped },
+               "state changes: starting, playing, paused, starting, playing, stopped, starting, playing, stopped");
+    }
+
+    /** Plays the start of the fixture with no DSP at the given gain and
+        balance, and keeps only what follows the parameter ramps.
+    */
+    void renderSteady (float gain, float pan)
+    {
+        engine.setLoudnessMeteringEnabled (false);
+        engine.setNumOutputChannels (2);
+        engine.prepareToPlay (blockSize, sampleRate);
+        engine.setGain (gain);
+        engine.setPan (pan);
+
+        if (! check (engine.loadFile (fixture), "load the fixture"))
+            return;
+
+        engine.play();
+        pump (blocksFor (0.2));
+
+        rendered = {};
+        pump (blocksFor (0.5));
+        check (! lastBlockSilent, "the fixture's opening isn't silent");
+    }
+
+    /** Each channel of rendered, against the same channel of unity times its gain. */
+    bool isScaledFrom (const EngineTest& unity, std::array<float, 2> channelGains) const
+    {
+        const auto expected = unity.rendered.toBuffer();
+        const auto actual = rendered.toBuffer();
+
+        if (expected.getNumSamples() != actual.getNumSamples() || expected.getNumSamples() == 0)
+            return false;
+
+        const auto peak = expected.getMagnitude (0, expected.getNumSamples());
+        float maxError = 0.0f;
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < actual.getNumSamples(); ++i)
+                maxError = juce::jmax (maxError, std::abs (actual.getSample (ch, i) - expected.getSample (ch, i) * channelGains[(size_t) ch]));
+
+        const auto errorDecibels = juce::Decibels::gainToDecibels (maxError / peak, -200.0f);
+
+        if (errorDecibels > maxScalingErrorDecibels)
+            juce::Logger::writeToLog (juce::String::formatted ("[test] scaling error %.1f dB below the peak", -errorDecibels));
+
+        return peak > 0.0f && errorDecibels <= maxScalingErrorDecibels;
+    }
+
+    /** Runs the callback numBlocks times, appending the output to rendered. */
+    void pump (int numBlocks, bool positionMustAdvance = false)
+    {
+        juce::AudioBuffer<float> block (2, blockSize);
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            const auto positionBefore = engine.getCurrentPosition();
+
+            block.clear();
+            const juce::AudioSourceChannelInfo info (&block, 0, blockSize);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            engine.getNextAudioBlock (info);
+            const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+            totalSeconds += seconds;
+            maxSeconds = juce::jmax (maxSeconds, seconds);
+            ++numBlocksRun;
+
+            engine.dispatchPendingUpdates();
+
+            lastBlockSilent = block.getMagnitude (0, blockSize) == 0.0f;
+            rendered.add (block);
+
+            if (positionMustAdvance && engine.getCurrentPosition() < positionBefore)
+                check (false, juce::String::formatted ("position went back from %.4f s to %.4f s",
+                                                       positionBefore, engine.getCurrentPosition()));
+        }
+    }
+
+    int blocksFor (double seconds) const
+    {
+        return juce::jmax (1, (int) std::ceil (seconds * sampleRate / blockSize));
+    }
+
+    bool check (bool condition, const juce::String& what)
+    {
+        if (! condition)
+        {
+            juce::Logger::writeToLog ("[test] FAILED, " + juce::String (blockSize) + "-sample blocks: " + what);
+            ++failures;
+        }
+
+        return condition;
+    }
+
+    void checkLoad()
+    {
+        const auto blockSeconds = blockSize / sampleRate;
+        const auto meanLoad = totalSeconds / juce::jmax (1, numBlocksRun) / blockSeconds;
+        const auto maxLoad = maxSeconds / blockSeconds;
+
+        juce::Logger::writeToLog (juce::String::formatted ("[test] %4d-sample blocks: %d blocks, mean %.2f %%, max %.2f %% of the block period",
+                                                           blockSize, numBlocksRun, meanLoad * 100.0, maxLoad * 100.0));
+
+        check (meanLoad <= meanLoadBudget, juce::String::formatted ("mean block cost over %.0f %% of the block period", meanLoadBudget * 100.0));
+        check (maxLoad <= maxLoadBudget, juce::String::formatted ("a block cost over %.0f %% of the block period", maxLoadBudget * 100.0));
+    }
+
+    //==============================================================================
+    /** The whole run's output, block after block. */
+    struct Rendering
+    {
+        void add (const juce::AudioBuffer<float>& block)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                channels[(size_t) ch].insert (channels[(size_t) ch].end(), block.getReadPointer (ch),
+                                              block.getReadPointer (ch) + block.getNumSamples());
+        }
+
+        juce::AudioBuffer<float> toBuffer() const
+        {
+            juce::AudioBuffer<float> buffer (2, (int) channels[0].size());
+
+            for (int ch = 0; ch < 2; ++ch)
+                juce::FloatVectorOperations::copy (buffer.getWritePointer (ch), channels[(size_t) ch].data(), buffer.getNumSamples());
+
+            return buffer;
+        }
+
+        // Compared as bits, so 0.0f and -0.0f or two NaNs don't pass for each other
+        bool operator== (const Rendering& other) const
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                if (channels[(size_t) ch].size() != other.channels[(size_t) ch].size()
+                     || std::memcmp (channels[(size_t) ch].data(), other.channels[(size_t) ch].data(),
+                                     channels[(size_t) ch].size() * sizeof (float)) != 0)
+                    return false;
+
+            return true;
+        }
+
+        std::array<std::vector<float>, 2> channels;
+    };
+
+    const juce::File fixture;
+    const int blockSize;
+
+    juce::AudioFormatManager formats;
+    PlayerEngine engine { formats };
+
+    juce::Array<State> states;
+    Rendering rendered;
+    bool lastBlockSilent = false;
+    int failures = 0;
+
+    double totalSeconds = 0.0, maxSeconds = 0.0;
+    int numBlocksRun = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EngineTest)
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+   ExportJob.h
+
+   Offline render of the loaded file through the gain / balance stage and the
+   DSP chain to WAV / FLAC / Ogg Vorbis.
+
+   Three stages run on three threads:
+     - decode:  BufferingAudioReader reads ahead on its own TimeSliceThread,
+     - process: this job's thread applies gain and the chain,
+     - encode:  AudioFormatWriter::ThreadedWriter drains into the encoder on a
+                second TimeSliceThread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlaybackDSP.h"
+
+class ExportJob  : public juce::ThreadWithProgressWindow
+{
+public:
+    struct Options
+    {
+        juce::File source, destination;
+        float gain = 1.0f, pan = 0.0f;
+        bool dspEnabled = false;
+        PlaybackDSP::Settings dspSettings;
+    };
+
+    /** Call launchThread(). The owner keeps the job, and formats and parent
+        must outlive it: deleting it cancels an export still running.
+    */
+    ExportJob (juce::AudioFormatManager& formats, Options optionsToUse, juce::Component* parent)
+        : juce::ThreadWithProgressWindow ("Exporting " + optionsToUse.destination.getFileName(),
+                                          true, true, 10000, {}, parent),
+          formatManager (formats),
+          options (std::move (optionsToUse))
+    {
+    }
+
+    static juce::String getWildcard()       { return "*.wav;*.flac;*.ogg"; }
+
+    void run() override
+    {
+        result = render();
+
+        if (result.failed() || threadShouldExit())
+            options.destination.deleteFile();
+    }
+
+    void threadComplete (bool userPressedCancel) override
+    {
+        if (userPressedCancel)
+            result = juce::Result::fail ("Export cancelled.");
+
+        if (result.wasOk())
+            juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::InfoIcon, "Export",
+                                                    options.destination.getFullPathName() + "\n" + summary);
+        else
+            juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon, "Export",
+                                                    result.getErrorMessage());
+    }
+
+private:
+    static constexpr int blockSize = 4096;
+
+    juce::Result render()
+    {
+        std::unique_ptr<juce::AudioFormatReader> sourceReader (formatManager.createReaderFor (options.source));
+
+        if (sourceReader == nullptr)
+            return juce::Result::fail ("Can't read " + options.source.getFileName());
+
+        auto* format = formatManager.findFormatForFileExtension (options.destination.getFileExtension());
+
+        if (format == nullptr)
+            return juce::Result::fail ("Unsupported export format: " + options.destination.getFileExtension());
+
+        const auto sampleRate  = sourceReader->sampleRate;
+        const auto numChannels = (int) sourceReader->numChannels;
+        const auto length      = sourceReader->lengthInSamples;
+
+        options.destination.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (options.destination.createOutputStream());
+
+        if (stream == nullptr)
+            return juce::Result::fail ("Can't write to " + options.destination.getFullPathName());
+
+        const auto bitDepth = format->getPossibleBitDepths().contains (24) ? 24 : 16;
+        const auto quality  = format->getQualityOptions().size() / 2;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), sampleRate,
+                                                                                  (unsigned int) numChannels,
+                                                                                  bitDepth, {}, quality));
+        if (writer == nullptr)
+            return juce::Result::fail ("The " + format->getFormatName() + " encoder rejected these settings");
+
+        stream.release(); // now owned by the writer
+
+        juce::TimeSliceThread decodeThread ("Export decode"), encodeThread ("Export encode");
+        decodeThread.startThread();
+        encodeThread.startThread();
+
+        juce::BufferingAudioReader reader (sourceReader.release(), decodeThread, blockSize * 16);
+        reader.setReadTimeout (10000);
+
+        auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter> (writer.release(), encodeThread, blockSize * 16);
+
+        PlaybackDSP::Chain chain;
+        chain.setSettings (options.dspSettings);
+        chain.prepare (sampleRate, blockSize, numChannels);
+        chain.setEnabled (options.dspEnabled);
+
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        auto lastStatusMs = startMs;
+
+        for (juce::int64 pos = 0; pos < length && ! threadShouldExit();)
+        {
+            const auto num = (int) juce::jmin ((juce::int64) blockSize, length - pos);
+
+            reader.read (&buffer, 0, num, pos, true, true);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                if (const auto g = options.gain * PlaybackDSP::getBalanceGain (ch, numChannels, options.pan); g != 1.0f)
+                    buffer.applyGain (ch, 0, num, g);
+
+            chain.process (buffer, 0, num);
+
+            // The encoder FIFO is full: wait for the encode thread to catch up
+            while (! threadedWriter->write (buffer.getArrayOfReadPointers(), num) && ! threadShouldExit())
+                wait (1);
+
+            pos += num;
+
+            const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+
+            if (nowMs - lastStatusMs > 200.0 || pos >= length)
+            {
+                lastStatusMs = nowMs;
+                setProgress ((double) pos / (double) length);
+                setStatusMessage (getThroughputText (pos, sampleRate, nowMs - startMs));
+            }
+        }
+
+        threadedWriter.reset(); // flushes what's left in the FIFO
+        summary = getThroughputText (length, sampleRate, juce::Time::getMillisecondCounterHiRes() - startMs);
+
+        return juce::Result::ok();
+    }
+
+    static juce::String getThroughputText (juce::int64 samplesDone, double sampleRate, double elapsedMs)
+    {
+        const auto audioSeconds = (double) samplesDone / sampleRate;
+        const auto speed = elapsedMs > 0.0 ? audioSeconds * 1000.0 / elapsedMs : 0.0;
+
+        return juce::String::formatted ("%.1f s of audio, %.1fx real-time", audioSeconds, speed);
+    }
+
+    juce::AudioFormatManager& formatManager;
+    Options options;
+    juce::Result result { juce::Result::ok() };
+    juce::String summary;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExportJob)
+};
@@ -0,0 +1,281 @@
+/*
+  ==============================================================================
+
+   ImageAssetCache.h
+
+   Loads a bitmap resource off the message thread, keeps a decoded copy on disk
+   for the next cold start, and hands out copies pre-scaled for each display
+   scale factor so that paint() only ever blits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "StartupTrace.h"
+
+//==============================================================================
+/** Looks for Resources/<name> next to the executable or in one of its parent
+    folders (the Linux/Xcode/VS build folders sit a few levels below the
+    project root), or inside the app bundle on macOS.
+*/
+inline juce::File findResourceFile (const juce::String& name)
+{
+    auto dir = juce::File::getSpecialLocation (juce::File::currentExecutableFile).getParentDirectory();
+
+    for (int depth = 0; depth < 6 && dir.exists(); ++depth)
+    {
+        for (auto candidate : { dir.getChildFile ("Resources").getChildFile (name),
+                                dir.getChildFile (name) })
+            if (candidate.existsAsFile())
+                return candidate;
+
+        dir = dir.getParentDirectory();
+    }
+
+    return {};
+}
+
+//==============================================================================
+/** A background image that is decoded asynchronously and cached per scale.
+
+    - At start-up a worker either maps the raw decoded copy left in the user's
+      cache folder by a previous run, or decodes the PNG and writes that copy.
+    - For every display scale factor, one version is rescaled to cover the
+      largest display, so drawing is a 1:1 crop rather than a resample.
+*/
+class ImageAssetCache
+{
+public:
+    ImageAssetCache (const juce::String& resourceName, std::function<void()> onImageReady)
+        : sourceFile (findResourceFile (resourceName)),
+          cacheFile (getCacheFolder().getChildFile (resourceName + ".raw")),
+          onReady (std::move (onImageReady))
+    {
+        for (auto& display : juce::Desktop::getInstance().getDisplays().displays)
+        {
+            coverSize = coverSize.getUnion (display.totalArea.withZeroOrigin());
+            scalesToPrepare.addIfNotAlreadyThere ((float) display.scale);
+        }
+
+        if (sourceFile.existsAsFile())
+        {
+            loader = std::make_unique<BackgroundStartup> ([this, weakThis = juce::WeakReference<ImageAssetCache> (this)]
+            {
+                auto decoded = loadDecoded();
+                auto scaled  = std::make_shared<std::map<int, juce::Image>>();
+
+                if (decoded.isValid())
+                {
+                    StartupTrace::ScopedPhase phase ("pre-scale background");
+
+                    for (auto scale : scalesToPrepare)
+                        (*scaled)[getScaleKey (scale)] = createCoverImage (decoded, scale);
+                }
+
+                juce::MessageManager::callAsync ([weakThis, decoded, scaled]
+                {
+                    if (auto* cache = weakThis.get())
+                    {
+                        cache->original = decoded;
+                        cache->scaledImages = std::move (*scaled);
+
+                        if (cache->onReady != nullptr)
+                            cache->onReady();
+                    }
+                });
+            });
+
+            loader->start();
+        }
+    }
+
+    bool isReady() const noexcept                   { return original.isValid(); }
+
+    /** Draws the image so that it covers the area, centred, at the given opacity. */
+    void drawCovering (juce::Graphics& g, juce::Rectangle<int> area, float opacity)
+    {
+        if (! isReady() || area.isEmpty())
+            return;
+
+        const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const auto& image = getImageForScale (scale);
+
+        const auto physicalW = juce::roundToInt ((float) area.getWidth()  * scale);
+        const auto physicalH = juce::roundToInt ((float) area.getHeight() * scale);
+
+        juce::Graphics::ScopedSaveState saveState (g);
+        g.setOpacity (opacity);
+
+        if (physicalW <= image.getWidth() && physicalH <= image.getHeight())
+        {
+            // 1:1 in device pixels, so the renderer takes its plain blit path
+            g.drawImage (image,
+                         area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                         (image.getWidth()  - physicalW) / 2,
+                         (image.getHeight() - physicalH) / 2,
+                         physicalW, physicalH);
+        }
+        else
+        {
+            g.drawImage (image, area.toFloat(), juce::RectanglePlacement::fillDestination);
+        }
+    }
+
+private:
+    //==============================================================================
+    static juce::File getCacheFolder()
+    {
+        return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                 .getChildFile (juce::JUCEApplicationBase::getInstance() != nullptr
+                                    ? juce::JUCEApplicationBase::getInstance()->getApplicationName()
+                                    : juce::String ("PlayingSoundFilesTutorial"))
+                 .getChildFile ("ImageCache");
+    }
+
+    static int getScaleKey (float scale) noexcept   { return juce::roundToInt (scale * 100.0f); }
+
+    juce::Image createCoverImage (const juce::Image& source, float scale) const
+    {
+        const auto targetW = (double) coverSize.getWidth()  * scale;
+        const auto targetH = (double) coverSize.getHeight() * scale;
+
+        if (targetW <= 0 || targetH <= 0)
+            return source;
+
+        const auto ratio = juce::jmax (targetW / source.getWidth(), targetH / source.getHeight());
+
+        return source.rescaled (juce::roundToInt (source.getWidth()  * ratio),
+                                juce::roundToInt (source.getHeight() * ratio),
+                                juce::Graphics::highResamplingQuality);
+    }
+
+    const juce::Image& getImageForScale (float scale)
+    {
+        auto& image = scaledImages[getScaleKey (scale)];
+
+        // A display that wasn't around at start-up: scale once, then reuse
+        if (! image.isValid())
+            image = createCoverImage (original, scale);
+
+        return image;
+    }
+
+    //==============================================================================
+    // Raw cache layout: header, then the pixel rows exactly as in BitmapData.
+    struct RawHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::int32 width, height, pixelFormat, pixelStride;
+        juce::int64 sourceSize, sourceModificationTime;
+    };
+
+    static constexpr juce::uint32 rawMagic   = 0x52584d55; // "UMXR"
+    static constexpr juce::uint32 rawVersion = 1;
+
+    juce::Image loadDecoded() const
+    {
+        {
+            StartupTrace::ScopedPhase phase ("background from raw cache");
+
+            if (auto image = readRawCache(); image.isValid())
+                return image;
+        }
+
+        juce::Image image;
+
+        {
+            StartupTrace::ScopedPhase phase ("background PNG decode");
+            image = juce::ImageFileFormat::loadFrom (sourceFile);
+        }
+
+        if (image.isValid())
+            writeRawCache (image);
+
+        return image;
+    }
+
+    juce::Image readRawCache() const
+    {
+        juce::MemoryMappedFile mapped (cacheFile, juce::MemoryMappedFile::readOnly);
+
+        if (mapped.getData() == nullptr || mapped.getSize() < sizeof (RawHeader))
+            return {};
+
+        RawHeader header;
+        std::memcpy (&header, mapped.getData(), sizeof (header));
+
+        const auto format = (juce::Image::PixelFormat) header.pixelFormat;
+
+        if (header.magic != rawMagic || header.version != rawVersion
+             || header.sourceSize != sourceFile.getSize()
+             || header.sourceModificationTime != sourceFile.getLastModificationTime().toMilliseconds()
+             || (format != juce::Image::RGB && format != juce::Image::ARGB)
+             || header.width <= 0 || header.height <= 0)
+            return {};
+
+        const auto rowBytes = (size_t) header.width * (size_t) header.pixelStride;
+
+        if (mapped.getSize() < sizeof (RawHeader) + rowBytes * (size_t) header.height)
+            return {};
+
+        juce::Image image (format, header.width, header.height, false, juce::SoftwareImageType());
+        juce::Image::BitmapData pixels (image, juce::Image::BitmapData::writeOnly);
+
+        if (pixels.pixelStride != header.pixelStride)
+            return {};
+
+        auto* src = static_cast<const juce::uint8*> (mapped.getData()) + sizeof (RawHeader);
+
+        for (int y = 0; y < header.height; ++y)
+            std::memcpy (pixels.getLinePointer (y), src + rowBytes * (size_t) y, rowBytes);
+
+        return image;
+    }
+
+    void writeRawCache (const juce::Image& image) const
+    {
+        StartupTrace::ScopedPhase phase ("background raw cache write");
+
+        if (! cacheFile.getParentDirectory().createDirectory())
+            return;
+
+        const juce::Image::BitmapData pixels (image, juce::Image::BitmapData::readOnly);
+
+        RawHeader header { rawMagic, rawVersion,
+                           image.getWidth(), image.getHeight(),
+                           (juce::int32) image.getFormat(), pixels.pixelStride,
+                           sourceFile.getSize(), sourceFile.getLastModificationTime().toMilliseconds() };
+
+        juce::TemporaryFile temp (cacheFile);
+
+        if (auto out = temp.getFile().createOutputStream())
+        {
+            bool ok = out->write (&header, sizeof (header));
+
+            for (int y = 0; ok && y < image.getHeight(); ++y)
+                ok = out->write (pixels.getLinePointer (y), (size_t) image.getWidth() * (size_t) pixels.pixelStride);
+
+            out.reset();
+
+            if (ok)
+                temp.overwriteTargetFileWithTemporary();
+        }
+    }
+
+    //==============================================================================
+    const juce::File sourceFile, cacheFile;
+    std::function<void()> onReady;
+
+    juce::Rectangle<int> coverSize;
+    juce::Array<float> scalesToPrepare;
+
+    juce::Image original;
+    std::map<int, juce::Image> scaledImages;
+
+    std::unique_ptr<BackgroundStartup> loader;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (ImageAssetCache)
+    JUCE_DECLARE_NON_COPYABLE (ImageAssetCache)
+};
@@ -0,0 +1,388 @@
+/*
+  ==============================================================================
+
+   InputRecorder.h
+
+   Records the device's inputs to a WAV or FLAC file.
+
+   The audio thread only copies each input block into a large FIFO (ten
+   seconds by default). It doesn't lock, allocate or wait. If the FIFO is
+   full the block is dropped and counted as an overflow. A drain thread
+   empties the FIFO into AudioFormatWriter::ThreadedWriter, which encodes
+   and writes on its own TimeSliceThread. When the encoder falls behind,
+   the drain thread waits and the FIFO takes up the slack.
+
+   Capture runs as soon as the device is open. While not recording, the
+   drain thread keeps the last few seconds of input, and startRecording()
+   writes them first. A take therefore begins a little before the button
+   was pressed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class InputRecorder  : private juce::Thread
+{
+public:
+    static constexpr double fifoSeconds = 10.0;
+    static constexpr double preRollSeconds = 2.0;
+    static constexpr int maxChannels = 64;
+    static constexpr juce::uint32 stallTimeoutMs = 5000;
+
+    explicit InputRecorder (juce::AudioFormatManager& formats)
+        : juce::Thread ("Input recorder"),
+          formatManager (formats)
+    {
+    }
+
+    ~InputRecorder() override
+    {
+        stopRecording();
+        stopThread (4000);
+    }
+
+    /** Before capture() starts, e.g. from prepareToPlay. Ends any recording. */
+    void prepare (int numInputChannels, double newSampleRate)
+    {
+        stopRecording();
+        stopThread (4000);
+
+        numChannels = juce::jlimit (0, maxChannels, numInputChannels);
+        sampleRate = newSampleRate;
+
+        if (numChannels == 0 || sampleRate <= 0.0)
+            return;
+
+        const auto fifoSize = (int) (fifoSeconds * sampleRate);
+        ring.setSize (numChannels, fifoSize);
+        fifo.setTotalSize (fifoSize);
+        fifo.reset();
+
+        preRoll.setSize (numChannels, (int) (preRollSeconds * sampleRate));
+        preRollEnd = preRollFilled = 0;
+        samplesCaptured = samplesDrained = droppedSamples = 0;
+
+        startThread (juce::Thread::Priority::high);
+    }
+
+    //==============================================================================
+    /** Audio thread. Copies the first channels of the block, as prepared. */
+    void capture (const juce::AudioBuffer<float>& input, int startSample, int numSamples) noexcept
+    {
+        if (numChannels == 0 || ! isThreadRunning())
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        if (size1 + size2 < numSamples)
+        {
+            droppedSamples.fetch_add (numSamples, std::memory_order_relaxed);
+            return; // never half a block: the gap is either there or not
+        }
+
+        const auto channels = juce::jmin (numChannels, input.getNumChannels());
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (ch < channels)
+            {
+                ring.copyFrom (ch, start1, input, ch, startSample, size1);
+                ring.copyFrom (ch, start2, input, ch, startSample + size1, size2);
+            }
+            else
+            {
+                ring.clear (ch, start1, size1);
+                ring.clear (ch, start2, size2);
+            }
+        }
+
+        fifo.finishedWrite (size1 + size2);
+        samplesCaptured.fetch_add (numSamples, std::memory_order_release);
+    }
+
+    //==============================================================================
+    /** Message thread. The extension picks the format (.wav, .flac...). */
+    juce::Result startRecording (const juce::File& destination)
+    {
+        stopRecording();
+
+        if (numChannels == 0 || ! isThreadRunning())
+            return juce::Result::fail ("No input to record");
+
+        auto* format = formatManager.findFormatForFileExtension (destination.getFileExtension());
+
+        if (format == nullptr)
+            return juce::Result::fail ("Unsupported recording format: " + destination.getFileExtension());
+
+        destination.getParentDirectory().createDirectory();
+        destination.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (destination.createOutputStream());
+
+        if (stream == nullptr)
+            return juce::Result::fail ("Can't write to " + destination.getFullPathName());
+
+        const auto bitDepth = format->getPossibleBitDepths().contains (24) ? 24 : 16;
+        const auto quality  = format->getQualityOptions().size() / 2;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), sampleRate,
+                                                                                  (unsigned int) numChannels,
+                                                                                  bitDepth, {}, quality));
+        if (writer == nullptr)
+            return juce::Result::fail ("The " + format->getFormatName() + " encoder rejected these settings");
+
+        stream.release(); // now owned by the writer
+        encoderThread.startThread (juce::Thread::Priority::normal);
+
+        const juce::ScopedLock sl (writerLock);
+        threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter> (writer.release(), encoderThread,
+                                                                                    (int) (fifoSeconds * sampleRate));
+        preRollPending = true;
+        recordedFile = destination;
+        return juce::Result::ok();
+    }
+
+    /** Message thread. Writes everything captured up to now, then closes the file.
+
+        This takes as long as the drain thread needs to empty the FIFO, up to
+        fifoSeconds of audio. It only gives up if the drain makes no progress
+        at all for stallTimeoutMs (a dead disk), and logs what was lost.
+    */
+    void stopRecording()
+    {
+        if (! isRecording())
+            return;
+
+        const auto target = samplesCaptured.load (std::memory_order_acquire);
+        auto drained = samplesDrained.load (std::memory_order_acquire);
+        auto lastProgressMs = juce::Time::getMillisecondCounter();
+
+        while (drained < target)
+        {
+            juce::Thread::sleep (1);
+
+            if (const auto now = samplesDrained.load (std::memory_order_acquire); now != drained)
+            {
+                drained = now;
+                lastProgressMs = juce::Time::getMillisecondCounter();
+            }
+            else if (juce::Time::getMillisecondCounter() - lastProgressMs > stallTimeoutMs)
+            {
+                juce::Logger::writeToLog (juce::String::formatted ("[record] the drain stalled: %d captured sample(s) not written",
+                                                                   (int) (target - drained)));
+                break;
+            }
+        }
+
+        {
+            const juce::ScopedLock sl (writerLock);
+            threadedWriter.reset(); // flushes the encoder's own buffer
+        }
+
+        encoderThread.stopThread (4000);
+        juce::Logger::writeToLog ("[record] wrote " + recordedFile.getFullPathName());
+    }
+
+    bool isRecording() const
+    {
+        const juce::ScopedLock sl (writerLock);
+        return threadedWriter != nullptr;
+    }
+
+    /** Any thread: samples the audio thread had to drop since prepare(). */
+    juce::int64 getNumDroppedSamples() const noexcept     { return droppedSamples.load (std::memory_order_relaxed); }
+
+    //==============================================================================
+    /** Pushes simulated input as fast as the FIFO takes it (a 48 kHz device
+        with the given channel count) and logs how many times real time the
+        drain and encoder keep up with, to WAV and to FLAC. The figures count
+        what reached the closed file, not what was pushed.
+    */
+    static void runBenchmark (int numBenchmarkChannels = 32, double seconds = 30.0)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        const auto folder = juce::File::createTempFile ("record-benchmark");
+        constexpr double rate = 48000.0;
+        constexpr int blockSize = 256;
+
+        juce::AudioBuffer<float> block (numBenchmarkChannels, blockSize);
+        juce::Random random (1);
+
+        for (int ch = 0; ch < numBenchmarkChannels; ++ch)
+            for (int i = 0; i < blockSize; ++i)
+                block.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+        for (auto* extension : { ".wav", ".flac" })
+        {
+            // FLAC stops at 8 channels
+            const auto channels = juce::String (extension) == ".flac" ? juce::jmin (8, numBenchmarkChannels) : numBenchmarkChannels;
+
+            InputRecorder recorder (formats);
+            recorder.prepare (channels, rate);
+
+            const auto file = folder.getChildFile ("take").withFileExtension (extension);
+
+            if (const auto result = recorder.startRecording (file); result.failed())
+            {
+                juce::Logger::writeToLog ("[record] benchmark: " + result.getErrorMessage());
+                continue;
+            }
+
+            const auto total = (juce::int64) (seconds * rate);
+            const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+            for (juce::int64 pushed = 0; pushed < total;)
+            {
+                if (recorder.fifo.getFreeSpace() < blockSize)
+                {
+                    juce::Thread::yield();
+                    continue;
+                }
+
+                recorder.capture (block, 0, blockSize);
+                pushed += blockSize;
+            }
+
+            recorder.stopRecording();
+            const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+            const auto writtenSeconds = (double) recorder.samplesDrained.load() / rate;
+
+            juce::Logger::writeToLog (juce::String::formatted ("[record] %s, %d ch: %.1f of %.1f s of audio written in %.2f s = %.1fx real time, %.1f MB/s to disk, %d dropped",
+                                                               extension + 1, channels, writtenSeconds, seconds, elapsedSeconds,
+                                                               writtenSeconds / elapsedSeconds,
+                                                               (double) file.getSize() / (1024.0 * 1024.0) / elapsedSeconds,
+                                                               (int) recorder.getNumDroppedSamples()));
+        }
+
+        folder.deleteRecursively();
+    }
+
+private:
+    static constexpr int drainChunk = 4096;
+
+    void run() override
+    {
+        juce::int64 reportedDrops = 0;
+        juce::uint32 lastReportMs = 0;
+
+        while (! threadShouldExit())
+        {
+            // At most once a second, however long the overflow lasts
+            if (const auto dropped = getNumDroppedSamples();
+                dropped != reportedDrops && juce::Time::getMillisecondCounter() - lastReportMs > 1000)
+            {
+                juce::Logger::writeToLog (juce::String::formatted ("[record] input FIFO overflow: %d sample(s) dropped so far",
+                                                                   (int) dropped));
+                reportedDrops = dropped;
+                lastReportMs = juce::Time::getMillisecondCounter();
+            }
+
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (drainChunk, start1, size1, start2, size2);
+
+            if (size1 == 0)
+            {
+                wait (5);
+                continue;
+            }
+
+            if (! drain (start1, size1))
+            {
+                wait (2); // the encoder's buffer is full: leave it in the FIFO for now
+                continue;
+            }
+
+            fifo.finishedRead (size1);
+            samplesDrained.fetch_add (size1, std::memory_order_release);
+        }
+    }
+
+    /** Returns false if the samples couldn't be taken yet. */
+    bool drain (int start, int num)
+    {
+        std::array<const float*, maxChannels> channels {};
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[(size_t) ch] = ring.getReadPointer (ch, start);
+
+        const juce::ScopedLock sl (writerLock);
+
+        if (threadedWriter == nullptr)
+        {
+            keepForPreRoll (channels.data(), num);
+            return true;
+        }
+
+        if (preRollPending && ! writePreRoll())
+            return false;
+
+        return threadedWriter->write (channels.data(), num);
+    }
+
+    void keepForPreRoll (const float* const* channels, int num)
+    {
+        const auto size = preRoll.getNumSamples();
+
+        for (int done = 0; done < num;)
+        {
+            const auto n = juce::jmin (num - done, size - preRollEnd);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                preRoll.copyFrom (ch, preRollEnd, channels[ch] + done, n);
+
+            preRollEnd = (preRollEnd + n) % size;
+            preRollFilled = juce::jmin (size, preRollFilled + n);
+            done += n;
+        }
+    }
+
+    /** Oldest first: the wrapped part of the ring, then the rest. */
+    bool writePreRoll()
+    {
+        const auto size = preRoll.getNumSamples();
+        const auto oldest = (preRollEnd - preRollFilled + size) % size;
+        const auto firstPart = juce::jmin (preRollFilled, size - oldest);
+
+        std::array<const float*, maxChannels> channels {};
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[(size_t) ch] = preRoll.getReadPointer (ch, oldest);
+
+        if (firstPart > 0 && ! threadedWriter->write (channels.data(), firstPart))
+            return false;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            channels[(size_t) ch] = preRoll.getReadPointer (ch);
+
+        // The encoder's buffer holds fifoSeconds, well over the pre-roll: this fits
+        if (preRollFilled > firstPart)
+            threadedWriter->write (channels.data(), preRollFilled - firstPart);
+
+        preRollPending = false;
+        preRollEnd = preRollFilled = 0;
+        return true;
+    }
+
+    //==============================================================================
+    juce::AudioFormatManager& formatManager;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+
+    juce::AudioBuffer<float> ring;
+    juce::AbstractFifo fifo { 1 };
+    std::atomic<juce::int64> samplesCaptured { 0 }, samplesDrained { 0 }, droppedSamples { 0 };
+
+    juce::AudioBuffer<float> preRoll;   // drain thread only
+    int preRollEnd = 0, preRollFilled = 0;
+
+    juce::CriticalSection writerLock;   // never taken by the audio thread
+    std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> threadedWriter;
+    bool preRollPending = false;
+    juce::File recordedFile;
+    juce::TimeSliceThread encoderThread { "Recorder encoder" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InputRecorder)
+};
@@ -0,0 +1,427 @@
+/*
+  ==============================================================================
+
+   InsertChain.h
+
+   Third-party effects on the playback path: up to maxBranches parallel
+   branches, each an AudioProcessorGraph of plug-ins in series. Every
+   branch is fed the same input and the branch outputs are summed.
+
+   With a single branch the audio thread processes it in place. With more,
+   branches 2..n are handed to a pool of worker threads while the audio
+   thread runs branch 1. It then takes back any branch no worker has picked
+   up yet and runs it too, so a worker that failed to start or is slow to
+   wake costs parallelism, never a hung callback. It only waits for branches
+   a worker is already processing, before summing.
+
+   Every plug-in is wrapped in a TimedPlugin, which measures its own
+   processBlock; getNodeLoads() turns that into a CPU readout per node.
+
+   Plug-ins are added and removed on the message thread while audio runs;
+   AudioProcessorGraph swaps in its new rendering sequence by itself.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/** Forwards everything to a plug-in instance and times its processBlock. */
+class TimedPlugin  : public juce::AudioProcessor
+{
+public:
+    explicit TimedPlugin (std::unique_ptr<juce::AudioPluginInstance> instance)
+        : AudioProcessor (getBusesOf (*instance)),
+          plugin (std::move (instance))
+    {
+    }
+
+    juce::AudioPluginInstance& getPlugin() noexcept     { return *plugin; }
+
+    /** Share of the block period spent in this plug-in, smoothed. */
+    double getLoad() const                              { return load.getLoadAsProportion(); }
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int maximumBlockSize) override
+    {
+        plugin->setRateAndBufferSizeDetails (sampleRate, maximumBlockSize);
+        plugin->prepareToPlay (sampleRate, maximumBlockSize);
+        setLatencySamples (plugin->getLatencySamples());
+        load.reset (sampleRate, maximumBlockSize);
+    }
+
+    void releaseResources() override                    { plugin->releaseResources(); }
+
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) override
+    {
+        const juce::AudioProcessLoadMeasurer::ScopedTimer timer (load, buffer.getNumSamples());
+        plugin->processBlock (buffer, midi);
+    }
+
+    using AudioProcessor::processBlock;
+
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override { return plugin->checkBusesLayoutSupported (layouts); }
+
+    const juce::String getName() const override         { return plugin->getName(); }
+    double getTailLengthSeconds() const override        { return plugin->getTailLengthSeconds(); }
+    bool acceptsMidi() const override                   { return plugin->acceptsMidi(); }
+    bool producesMidi() const override                  { return plugin->producesMidi(); }
+
+    bool hasEditor() const override                     { return plugin->hasEditor(); }
+    juce::AudioProcessorEditor* createEditor() override { return plugin->createEditor(); }
+
+    int getNumPrograms() override                       { return plugin->getNumPrograms(); }
+    int getCurrentProgram() override                    { return plugin->getCurrentProgram(); }
+    void setCurrentProgram (int index) override         { plugin->setCurrentProgram (index); }
+    const juce::String getProgramName (int index) override                  { return plugin->getProgramName (index); }
+    void changeProgramName (int index, const juce::String& name) override   { plugin->changeProgramName (index, name); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override         { plugin->getStateInformation (destData); }
+    void setStateInformation (const void* data, int size) override          { plugin->setStateInformation (data, size); }
+
+private:
+    static BusesProperties getBusesOf (const juce::AudioProcessor& p)
+    {
+        BusesProperties buses;
+
+        for (int i = 0; i < p.getBusCount (true); ++i)
+            if (auto* bus = p.getBus (true, i))
+                buses.addBus (true, bus->getName(), bus->getCurrentLayout(), bus->isEnabled());
+
+        for (int i = 0; i < p.getBusCount (false); ++i)
+            if (auto* bus = p.getBus (false, i))
+                buses.addBus (false, bus->getName(), bus->getCurrentLayout(), bus->isEnabled());
+
+        return buses;
+    }
+
+    std::unique_ptr<juce::AudioPluginInstance> plugin;
+    juce::AudioProcessLoadMeasurer load;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimedPlugin)
+};
+
+//==============================================================================
+class InsertChain
+{
+public:
+    static constexpr int maxBranches = 4;
+
+    using Node = juce::AudioProcessorGraph::Node;
+    using NodeID = juce::AudioProcessorGraph::NodeID;
+
+    InsertChain()
+    {
+        using IO = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+
+        for (auto& branch : branches)
+        {
+            branch.graph = std::make_unique<juce::AudioProcessorGraph>();
+            branch.input  = branch.graph->addNode (std::make_unique<IO> (IO::audioInputNode));
+            branch.output = branch.graph->addNode (std::make_unique<IO> (IO::audioOutputNode));
+        }
+
+        for (auto& worker : workers)
+            worker = std::make_unique<Worker> (*this); // started with the second branch
+    }
+
+    ~InsertChain()
+    {
+        for (auto& worker : workers)
+            worker->stop();
+    }
+
+    //==============================================================================
+    /** From prepareToPlay. The I/O nodes follow the new channel count, so the
+        connections are rebuilt.
+    */
+    void prepare (double sampleRate, int maximumBlockSize, int numChannelsToUse)
+    {
+        numChannels = juce::jmax (1, numChannelsToUse);
+        blockSize = maximumBlockSize;
+
+        for (auto& branch : branches)
+        {
+            branch.buffer.setSize (numChannels, maximumBlockSize);
+            branch.midi.ensureSize (256);
+            branch.graph->setPlayConfigDetails (numChannels, numChannels, sampleRate, maximumBlockSize);
+            branch.graph->prepareToPlay (sampleRate, maximumBlockSize);
+            rewire (branch);
+        }
+    }
+
+    void releaseResources()
+    {
+        for (auto& branch : branches)
+            branch.graph->releaseResources();
+    }
+
+    /** Message thread. Appends a plug-in to the end of a branch. The chain is
+        as wide as the last branch holding a plug-in; an empty branch below
+        that one is a dry path, mixed in with the others.
+    */
+    void addPlugin (int branchIndex, std::unique_ptr<juce::AudioPluginInstance> instance)
+    {
+        auto& branch = branches[(size_t) juce::jlimit (0, maxBranches - 1, branchIndex)];
+
+        if (auto node = branch.graph->addNode (std::make_unique<TimedPlugin> (std::move (instance))))
+        {
+            branch.plugins.push_back (node->nodeID);
+            rewire (branch);
+        }
+
+        updateActiveBranches();
+    }
+
+    /** Message thread. */
+    void clear()
+    {
+        numActiveBranches = 0;
+
+        for (auto& branch : branches)
+        {
+            for (auto id : branch.plugins)
+                branch.graph->removeNode (id);
+
+            branch.plugins.clear();
+            rewire (branch);
+        }
+    }
+
+    int getNumBranches() const noexcept                 { return numActiveBranches.load(); }
+    int getNumPlugins (int branchIndex) const           { return (int) branches[(size_t) branchIndex].plugins.size(); }
+
+    struct NodeLoad
+    {
+        int branch;
+        juce::String name;
+        double load;    // share of the block period
+    };
+
+    /** Message thread. */
+    std::vector<NodeLoad> getNodeLoads() const
+    {
+        std::vector<NodeLoad> loads;
+
+        for (int b = 0; b < maxBranches; ++b)
+            for (auto id : branches[(size_t) b].plugins)
+                if (auto node = branches[(size_t) b].graph->getNodeForId (id))
+                    if (auto* timed = dynamic_cast<TimedPlugin*> (node->getProcessor()))
+                        loads.push_back ({ b, timed->getName(), timed->getLoad() });
+
+        return loads;
+    }
+
+    void logProcessingLoad() const
+    {
+        for (const auto& node : getNodeLoads())
+            juce::Logger::writeToLog (juce::String::formatted ("[insert] branch %d  %-24s %6.2f %% of the block period",
+                                                               node.branch + 1, node.name.toRawUTF8(), node.load * 100.0));
+    }
+
+    //==============================================================================
+    /** Audio thread. Replaces the first getNumChannels() channels of the
+        range with the sum of the branch outputs.
+    */
+    void process (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        const auto numBranches = numActiveBranches.load (std::memory_order_acquire);
+
+        if (numBranches == 0 || numSamples > blockSize)
+            return;
+
+        const auto channels = juce::jmin (numChannels, buffer.getNumChannels());
+
+        if (numBranches == 1)
+        {
+            auto& branch = branches[0];
+            copyIn (branch, buffer, startSample, numSamples, channels);
+            runBranch (branch);
+            copyOut (branch, buffer, startSample, numSamples, channels, false);
+            return;
+        }
+
+        for (int b = 0; b < numBranches; ++b)
+            copyIn (branches[(size_t) b], buffer, startSample, numSamples, channels);
+
+        // Branches 2..n to the workers, branch 1 here
+        pendingBranches.store (numBranches - 1, std::memory_order_release);
+
+        for (int b = 1; b < numBranches; ++b)
+            workers[(size_t) b - 1]->post (branches[(size_t) b]);
+
+        runBranch (branches[0]);
+
+        for (int b = 1; b < numBranches; ++b)
+        {
+            if (workers[(size_t) b - 1]->takeBack())
+            {
+                runBranch (branches[(size_t) b]);
+                pendingBranches.fetch_sub (1, std::memory_order_acq_rel);
+            }
+        }
+
+        // Only branches a worker is in the middle of are left: no longer than running them here
+        while (pendingBranches.load (std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+
+        for (int b = 0; b < numBranches; ++b)
+            copyOut (branches[(size_t) b], buffer, startSample, numSamples, channels, b > 0);
+    }
+
+private:
+    struct Branch
+    {
+        std::unique_ptr<juce::AudioProcessorGraph> graph;
+        Node::Ptr input, output;
+        std::vector<NodeID> plugins;
+
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        int numSamples = 0;
+    };
+
+    /** Runs one branch at a time, handed over from the audio thread. */
+    class Worker  : public juce::Thread
+    {
+    public:
+        explicit Worker (InsertChain& chainToServe)
+            : juce::Thread ("Insert branch"), chain (chainToServe)
+        {
+        }
+
+        void post (Branch& branch) noexcept
+        {
+            job.store (&branch, std::memory_order_release);
+            wake.signal();
+        }
+
+        /** Audio thread. True if the posted branch hadn't been picked up, and
+            is now the caller's to run.
+        */
+        bool takeBack() noexcept
+        {
+            return job.exchange (nullptr, std::memory_order_acq_rel) != nullptr;
+        }
+
+        void stop()
+        {
+            signalThreadShouldExit();
+            wake.signal();
+            stopThread (2000);
+        }
+
+    private:
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                wake.wait (100);
+
+                if (auto* branch = job.exchange (nullptr, std::memory_order_acq_rel))
+                {
+                    InsertChain::runBranch (*branch);
+                    chain.pendingBranches.fetch_sub (1, std::memory_order_acq_rel);
+                }
+            }
+        }
+
+        InsertChain& chain;
+        std::atomic<Branch*> job { nullptr };
+        juce::WaitableEvent wake;
+    };
+
+    static void copyIn (Branch& branch, const juce::AudioBuffer<float>& source, int startSample, int numSamples, int channels) noexcept
+    {
+        branch.buffer.setSize (branch.buffer.getNumChannels(), numSamples, false, false, true);
+
+        for (int ch = 0; ch < branch.buffer.getNumChannels(); ++ch)
+        {
+            if (ch < channels)
+                branch.buffer.copyFrom (ch, 0, source, ch, startSample, numSamples);
+            else
+                branch.buffer.clear (ch, 0, numSamples);
+        }
+    }
+
+    static void copyOut (const Branch& branch, juce::AudioBuffer<float>& dest, int startSample, int numSamples, int channels, bool add) noexcept
+    {
+        for (int ch = 0; ch < channels; ++ch)
+        {
+            if (add)
+                dest.addFrom (ch, startSample, branch.buffer, ch, 0, numSamples);
+            else
+                dest.copyFrom (ch, startSample, branch.buffer, ch, 0, numSamples);
+        }
+    }
+
+    static void runBranch (Branch& branch) noexcept
+    {
+        branch.midi.clear();
+        branch.graph->processBlock (branch.buffer, branch.midi);
+    }
+
+    /** input -> plug-ins in order -> output, channel by channel. */
+    void rewire (Branch& branch)
+    {
+        for (const auto& connection : branch.graph->getConnections())
+            branch.graph->removeConnection (connection);
+
+        auto previous = branch.input->nodeID;
+
+        for (auto id : branch.plugins)
+        {
+            connect (*branch.graph, previous, id);
+            previous = id;
+        }
+
+        connect (*branch.graph, previous, branch.output->nodeID);
+    }
+
+    static void connect (juce::AudioProcessorGraph& graph, NodeID source, NodeID dest)
+    {
+        auto src = graph.getNodeForId (source), dst = graph.getNodeForId (dest);
+
+        if (src == nullptr || dst == nullptr)
+            return;
+
+        const auto channels = juce::jmin (src->getProcessor()->getTotalNumOutputChannels(),
+                                          dst->getProcessor()->getTotalNumInputChannels());
+
+        for (int ch = 0; ch < channels; ++ch)
+            graph.addConnection ({ { source, ch }, { dest, ch } });
+    }
+
+    /** Branches are used from the first one up to the last with a plug-in. */
+    void updateActiveBranches()
+    {
+        int count = 0;
+
+        for (int b = 0; b < maxBranches; ++b)
+            if (! branches[(size_t) b].plugins.empty())
+                count = b + 1;
+
+        // Without real-time privileges (e.g. on Linux), a plain high-priority
+        // thread; if even that fails, process() runs the branch itself
+        for (int w = 0; w < count - 1; ++w)
+        {
+            auto& worker = *workers[(size_t) w];
+
+            if (worker.isThreadRunning()
+                 || worker.startRealtimeThread (juce::Thread::RealtimeOptions().withPriority (8))
+                 || worker.startThread (juce::Thread::Priority::highest))
+                continue;
+
+            juce::Logger::writeToLog ("[insert] can't start a worker: branch " + juce::String (w + 2) + " runs on the audio thread");
+        }
+
+        numActiveBranches.store (count, std::memory_order_release);
+    }
+
+    std::array<Branch, maxBranches> branches;
+    std::array<std::unique_ptr<Worker>, maxBranches - 1> workers;
+    std::atomic<int> numActiveBranches { 0 }, pendingBranches { 0 };
+    int numChannels = 2, blockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InsertChain)
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+   LockFreeExchange.h
+
+   Hands the latest value of a settings struct from one writer thread to one
+   reader thread (typically UI -> audio) without locks or allocation, and
+   smooths plain float parameters on their way to the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/** Triple buffer: the writer always has a free slot to fill, the reader always
+    sees a complete value, and intermediate writes the reader never picked up
+    are simply overwritten ("latest wins").
+*/
+template <typename ValueType>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    /** Writer thread only. */
+    void write (const ValueType& newValue) noexcept
+    {
+        slots[(size_t) back] = newValue;
+        back = middle.exchange (back | newDataFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** Reader thread only. Returns the newest value if one arrived since the
+        last call, or nullptr. The pointer stays valid until the next call.
+    */
+    const ValueType* readIfNew() noexcept
+    {
+        if ((middle.load (std::memory_order_acquire) & newDataFlag) == 0)
+            return nullptr;
+
+        front = middle.exchange (front, std::memory_order_acq_rel) & indexMask;
+        return &slots[(size_t) front];
+    }
+
+private:
+    static constexpr int indexMask = 3, newDataFlag = 4;
+
+    std::array<ValueType, 3> slots {};
+    int back = 0, front = 1;
+    std::atomic<int> middle { 2 };
+
+    JUCE_DECLARE_NON_COPYABLE (TripleBuffer)
+};
+
+//==============================================================================
+/** A fixed set of float parameters, written from any thread and read through
+    a juce::SmoothedValue on the audio thread.
+
+    Writers store the value and bump a generation counter. The audio thread
+    checks the counter once per block, so a burst of slider moves between two
+    callbacks costs one update.
+*/
+template <size_t NumParameters>
+class SmoothedParameters
+{
+public:
+    explicit SmoothedParameters (const std::array<float, NumParameters>& defaults)
+    {
+        for (size_t i = 0; i < NumParameters; ++i)
+        {
+            targets[i].store (defaults[i]);
+            smoothers[i].setCurrentAndTargetValue (defaults[i]);
+        }
+    }
+
+    /** Any thread. */
+    void set (size_t index, float newValue) noexcept
+    {
+        targets[index].store (newValue, std::memory_order_relaxed);
+        generation.fetch_add (1, std::memory_order_release);
+    }
+
+    /** Any thread: the latest value set, not the smoothed one. */
+    float get (size_t index) const noexcept
+    {
+        return targets[index].load (std::memory_order_relaxed);
+    }
+
+    /** Before the audio thread starts. Every parameter jumps to its target. */
+    void prepare (double sampleRate, double rampLengthSeconds)
+    {
+        seenGeneration = generation.load (std::memory_order_acquire);
+
+        for (size_t i = 0; i < NumParameters; ++i)
+        {
+            smoothers[i].reset (sampleRate, rampLengthSeconds);
+            smoothers[i].setCurrentAndTargetValue (get (i));
+        }
+    }
+
+    /** Audio thread, once at the start of each block. */
+    void update() noexcept
+    {
+        const auto current = generation.load (std::memory_order_acquire);
+
+        if (current == seenGeneration)
+            return;
+
+        seenGeneration = current;
+
+        for (size_t i = 0; i < NumParameters; ++i)
+            smoothers[i].setTargetValue (get (i));
+    }
+
+    /** Audio thread: advances every ramp, e.g. through a block of silence. */
+    void skip (int numSamples) noexcept
+    {
+        for (auto& smoother : smoothers)
+            smoother.skip (numSamples);
+    }
+
+    /** Audio thread. */
+    juce::SmoothedValue<float>& operator[] (size_t index) noexcept     { return smoothers[index]; }
+
+private:
+    std::array<std::atomic<float>, NumParameters> targets;
+    std::atomic<juce::uint32> generation { 0 };
+
+    std::array<juce::SmoothedValue<float>, NumParameters> smoothers;
+    juce::uint32 seenGeneration = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (SmoothedParameters)
+};
@@ -0,0 +1,464 @@
+/*
+  ==============================================================================
+
+   LoudnessMeter.h
+
+   ITU-R BS.1770-4 / EBU R128 metering: momentary, short-term and integrated
+   loudness (LUFS), loudness range (LU) and 4x-oversampled true peak (dBTP).
+
+   The audio callback only copies its output into a lock-free FIFO; the
+   K-weighting, gating and oversampling all happen on a worker thread that
+   drains that FIFO and publishes the readings through atomics.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class LoudnessMeter  : private juce::Thread
+{
+public:
+    static constexpr int maxChannels = 8;
+
+    struct Readings
+    {
+        float momentary  = -std::numeric_limits<float>::infinity();
+        float shortTerm  = -std::numeric_limits<float>::infinity();
+        float integrated = -std::numeric_limits<float>::infinity();
+        float range      = 0.0f;
+        float truePeak   = -std::numeric_limits<float>::infinity();
+    };
+
+    LoudnessMeter()  : juce::Thread ("Loudness meter") {}
+
+    ~LoudnessMeter() override
+    {
+        stopThread (1000);
+    }
+
+    /** Call from prepareToPlay, before the callback starts. */
+    void prepare (double newSampleRate, int numChannelsToMeasure)
+    {
+        stopThread (1000);
+
+        sampleRate = newSampleRate;
+        numChannels = juce::jlimit (1, maxChannels, numChannelsToMeasure);
+
+        const auto fifoSize = juce::nextPowerOfTwo ((int) sampleRate); // one second of slack
+        fifo.setTotalSize (fifoSize);
+        fifoBuffer.setSize (maxChannels, fifoSize);
+        drainBuffer.setSize (maxChannels, fifoSize);
+
+        samplesPerSubBlock = juce::roundToInt (sampleRate * 0.1);
+        setUpKWeighting();
+        setUpOversampler();
+        resetState();
+
+        startThread (juce::Thread::Priority::low);
+    }
+
+    /** Audio thread: copies the block into the FIFO. Never blocks; if the
+        worker has fallen a second behind, the block is dropped and counted.
+    */
+    void pushBlock (const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        if (fifoBuffer.getNumSamples() == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        if (size1 + size2 < numSamples)
+        {
+            droppedSamples.fetch_add (numSamples, std::memory_order_relaxed);
+            return;
+        }
+
+        const auto num = juce::jmin (numChannels, buffer.getNumChannels());
+
+        for (int ch = 0; ch < num; ++ch)
+        {
+            fifoBuffer.copyFrom (ch, start1, buffer, ch, startSample, size1);
+
+            if (size2 > 0)
+                fifoBuffer.copyFrom (ch, start2, buffer, ch, startSample + size1, size2);
+        }
+
+        for (int ch = num; ch < numChannels; ++ch)
+        {
+            fifoBuffer.clear (ch, start1, size1);
+
+            if (size2 > 0)
+                fifoBuffer.clear (ch, start2, size2);
+        }
+
+        fifo.finishedWrite (size1 + size2);
+    }
+
+    /** Any thread: restarts the integrated, range and peak measurements. */
+    void reset() noexcept                       { resetRequested = true; }
+
+    Readings getReadings() const noexcept
+    {
+        Readings r;
+        r.momentary  = momentary.load();
+        r.shortTerm  = shortTerm.load();
+        r.integrated = integrated.load();
+        r.range      = range.load();
+        r.truePeak   = truePeak.load();
+        return r;
+    }
+
+    juce::int64 getNumDroppedSamples() const noexcept       { return droppedSamples.load(); }
+
+private:
+    //==============================================================================
+    struct Biquad
+    {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        std::array<double, maxChannels> z1 {}, z2 {};
+
+        double process (double x, int ch) noexcept
+        {
+            const auto y = b0 * x + z1[(size_t) ch];
+            z1[(size_t) ch] = b1 * x - a1 * y + z2[(size_t) ch];
+            z2[(size_t) ch] = b2 * x - a2 * y;
+            return y;
+        }
+
+        void reset() noexcept       { z1.fill (0); z2.fill (0); }
+    };
+
+    // Gated block loudness histogram, 0.1 LU bins from -70 to +10 LUFS
+    struct Histogram
+    {
+        static constexpr double minLufs = -70.0, binWidth = 0.1;
+        static constexpr int numBins = 800;
+
+        std::array<juce::uint32, numBins> counts {};
+
+        void clear() noexcept                           { counts.fill (0); }
+
+        static double binCentre (int bin) noexcept      { return minLufs + (bin + 0.5) * binWidth; }
+
+        void add (double lufs) noexcept
+        {
+            if (lufs >= minLufs)
+                ++counts[(size_t) juce::jlimit (0, numBins - 1, (int) ((lufs - minLufs) / binWidth))];
+        }
+
+        int firstBinAbove (double lufs) const noexcept
+        {
+            return juce::jlimit (0, numBins, (int) std::ceil ((lufs - minLufs) / binWidth - 0.5));
+        }
+    };
+
+    static double energyToLufs (double energy) noexcept
+    {
+        return energy > 0.0 ? -0.691 + 10.0 * std::log10 (energy) : -std::numeric_limits<double>::infinity();
+    }
+
+    static double lufsToEnergy (double lufs) noexcept
+    {
+        return std::pow (10.0, (lufs + 0.691) / 10.0);
+    }
+
+    //==============================================================================
+    void setUpKWeighting()
+    {
+        // Pre-filter (high shelf) and RLB high-pass, re-derived for any sample
+        // rate as in libebur128
+        const auto pi = juce::MathConstants<double>::pi;
+
+        {
+            const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+            const auto k  = std::tan (pi * f0 / sampleRate);
+            const auto vh = std::pow (10.0, gain / 20.0);
+            const auto vb = std::pow (vh, 0.4996667741545416);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            shelf.b0 = (vh + vb * k / q + k * k) / a0;
+            shelf.b1 = 2.0 * (k * k - vh) / a0;
+            shelf.b2 = (vh - vb * k / q + k * k) / a0;
+            shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+            shelf.a2 = (1.0 - k / q + k * k) / a0;
+        }
+
+        {
+            const double f0 = 38.13547087602444, q = 0.5003270373238773;
+            const auto k  = std::tan (pi * f0 / sampleRate);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            highPass.b0 = 1.0;
+            highPass.b1 = -2.0;
+            highPass.b2 = 1.0;
+            highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+            highPass.a2 = (1.0 - k / q + k * k) / a0;
+        }
+
+        // BS.1770 channel weights; for 5.1 (L R C LFE Ls Rs) the LFE is ignored
+        // and the surrounds get +1.5 dB
+        channelWeights.fill (1.0);
+
+        if (numChannels == 6)
+        {
+            channelWeights[3] = 0.0;
+            channelWeights[4] = channelWeights[5] = 1.41;
+        }
+    }
+
+    void setUpOversampler()
+    {
+        // 4 phases x 12 taps, Hann-windowed sinc with its cut-off at the
+        // original Nyquist frequency
+        const auto centre = (double) (oversampleTaps * oversampleFactor - 1) * 0.5;
+
+        for (int phase = 0; phase < oversampleFactor; ++phase)
+        {
+            for (int tap = 0; tap < oversampleTaps; ++tap)
+            {
+                const auto n = tap * oversampleFactor + phase;
+                const auto x = ((double) n - centre) / oversampleFactor;
+                const auto sinc = x == 0.0 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+                const auto window = 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * (n + 0.5) / (oversampleTaps * oversampleFactor));
+                oversampleCoefficients[(size_t) phase][(size_t) tap] = (float) (sinc * window);
+            }
+        }
+    }
+
+    void resetState()
+    {
+        shelf.reset();
+        highPass.reset();
+
+        for (auto& h : peakHistory)
+            h.fill (0.0f);
+
+        subBlockEnergy.fill ({});
+        currentSubBlock.fill (0.0);
+        samplesInSubBlock = 0;
+        subBlocksSeen = 0;
+        subBlockIndex = 0;
+        peakHistoryPos = 0;
+        maxTruePeak = 0.0f;
+
+        momentaryHistogram.clear();
+        shortTermHistogram.clear();
+
+        momentary = shortTerm = integrated = truePeak = -std::numeric_limits<float>::infinity();
+        range = 0.0f;
+    }
+
+    //==============================================================================
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (resetRequested.exchange (false))
+                resetState();
+
+            drain();
+            wait (10);
+        }
+    }
+
+    void drain()
+    {
+        const auto ready = fifo.getNumReady();
+
+        if (ready <= 0)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (ready, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            drainBuffer.copyFrom (ch, 0, fifoBuffer, ch, start1, size1);
+
+            if (size2 > 0)
+                drainBuffer.copyFrom (ch, size1, fifoBuffer, ch, start2, size2);
+        }
+
+        fifo.finishedRead (size1 + size2);
+
+        for (int i = 0; i < size1 + size2; ++i)
+            processSample (i);
+
+        truePeak = maxTruePeak > 0.0f ? juce::Decibels::gainToDecibels (maxTruePeak) : -std::numeric_limits<float>::infinity();
+    }
+
+    void processSample (int index) noexcept
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto x = drainBuffer.getSample (ch, index);
+
+            const auto weighted = highPass.process (shelf.process (x, ch), ch);
+            currentSubBlock[(size_t) ch] += weighted * weighted;
+
+            // True peak: push into the per-channel history, then evaluate all
+            // four interpolation phases for this input sample
+            auto& history = peakHistory[(size_t) ch];
+            history[(size_t) peakHistoryPos] = x;
+
+            for (int phase = 0; phase < oversampleFactor; ++phase)
+            {
+                float sum = 0.0f;
+                const auto& c = oversampleCoefficients[(size_t) phase];
+
+                for (int tap = 0; tap < oversampleTaps; ++tap)
+                    sum += c[(size_t) tap] * history[(size_t) ((peakHistoryPos - tap + oversampleTaps) % oversampleTaps)];
+
+                maxTruePeak = juce::jmax (maxTruePeak, std::abs (sum));
+            }
+        }
+
+        peakHistoryPos = (peakHistoryPos + 1) % oversampleTaps;
+
+        if (++samplesInSubBlock >= samplesPerSubBlock)
+            finishSubBlock();
+    }
+
+    /** Every 100 ms: update momentary (400 ms) and short-term (3 s) windows
+        and feed the gating histograms.
+    */
+    void finishSubBlock() noexcept
+    {
+        double energy = 0.0;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            energy += channelWeights[(size_t) ch] * currentSubBlock[(size_t) ch] / samplesInSubBlock;
+
+        subBlockEnergy[(size_t) subBlockIndex] = energy;
+        subBlockIndex = (subBlockIndex + 1) % (int) subBlockEnergy.size();
+        ++subBlocksSeen;
+
+        currentSubBlock.fill (0.0);
+        samplesInSubBlock = 0;
+
+        const auto windowEnergy = [this] (int numSubBlocks)
+        {
+            double sum = 0.0;
+
+            for (int i = 1; i <= numSubBlocks; ++i)
+                sum += subBlockEnergy[(size_t) ((subBlockIndex - i + (int) subBlockEnergy.size()) % (int) subBlockEnergy.size())];
+
+            return sum / numSubBlocks;
+        };
+
+        if (subBlocksSeen >= 4)
+        {
+            const auto m = energyToLufs (windowEnergy (4));
+            momentary = (float) m;
+            momentaryHistogram.add (m);
+            integrated = (float) computeIntegrated();
+        }
+
+        if (subBlocksSeen >= 30)
+        {
+            const auto s = energyToLufs (windowEnergy (30));
+            shortTerm = (float) s;
+            shortTermHistogram.add (s);
+            range = (float) computeRange();
+        }
+    }
+
+    double computeIntegrated() const noexcept
+    {
+        // Absolute gate (-70 LUFS) is the histogram's floor; then gate again
+        // 10 LU below the mean of what passed
+        const auto gatedMean = [this] (int firstBin)
+        {
+            double energy = 0.0;
+            juce::uint64 count = 0;
+
+            for (int bin = firstBin; bin < Histogram::numBins; ++bin)
+            {
+                const auto n = momentaryHistogram.counts[(size_t) bin];
+                energy += n * lufsToEnergy (Histogram::binCentre (bin));
+                count += n;
+            }
+
+            return count > 0 ? energyToLufs (energy / (double) count) : -std::numeric_limits<double>::infinity();
+        };
+
+        const auto ungated = gatedMean (0);
+
+        if (! std::isfinite (ungated))
+            return ungated;
+
+        return gatedMean (momentaryHistogram.firstBinAbove (ungated - 10.0));
+    }
+
+    double computeRange() const noexcept
+    {
+        // EBU Tech 3342: gate 20 LU below the mean, then the 10th to 95th
+        // percentile spread of the short-term values
+        double energy = 0.0;
+        juce::uint64 count = 0;
+
+        for (int bin = 0; bin < Histogram::numBins; ++bin)
+        {
+            energy += shortTermHistogram.counts[(size_t) bin] * lufsToEnergy (Histogram::binCentre (bin));
+            count += shortTermHistogram.counts[(size_t) bin];
+        }
+
+        if (count == 0)
+            return 0.0;
+
+        const auto firstBin = shortTermHistogram.firstBinAbove (energyToLufs (energy / (double) count) - 20.0);
+        juce::uint64 gatedCount = 0;
+
+        for (int bin = firstBin; bin < Histogram::numBins; ++bin)
+            gatedCount += shortTermHistogram.counts[(size_t) bin];
+
+        if (gatedCount == 0)
+            return 0.0;
+
+        const auto percentile = [&] (double p)
+        {
+            const auto target = (juce::uint64) std::ceil (p * (double) gatedCount);
+            juce::uint64 seen = 0;
+
+            for (int bin = firstBin; bin < Histogram::numBins; ++bin)
+                if ((seen += shortTermHistogram.counts[(size_t) bin]) >= juce::jmax ((juce::uint64) 1, target))
+                    return Histogram::binCentre (bin);
+
+            return Histogram::binCentre (Histogram::numBins - 1);
+        };
+
+        return percentile (0.95) - percentile (0.10);
+    }
+
+    //==============================================================================
+    static constexpr int oversampleFactor = 4, oversampleTaps = 12;
+
+    double sampleRate = 48000.0;
+    int numChannels = 2;
+
+    juce::AbstractFifo fifo { 1024 };
+    juce::AudioBuffer<float> fifoBuffer, drainBuffer;
+    std::atomic<juce::int64> droppedSamples { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    // Worker-thread state
+    Biquad shelf, highPass;
+    std::array<double, maxChannels> channelWeights {}, currentSubBlock {};
+    std::array<double, 30> subBlockEnergy {};
+    int samplesPerSubBlock = 4800, samplesInSubBlock = 0, subBlockIndex = 0;
+    juce::int64 subBlocksSeen = 0;
+
+    std::array<std::array<float, oversampleTaps>, oversampleFactor> oversampleCoefficients {};
+    std::array<std::array<float, oversampleTaps>, maxChannels> peakHistory {};
+    int peakHistoryPos = 0;
+    float maxTruePeak = 0.0f;
+
+    Histogram momentaryHistogram, shortTermHistogram;
+
+    // Published readings
+    static constexpr float silence = -std::numeric_limits<float>::infinity();
+    std::atomic<float> momentary { silence }, shortTerm { silence }, integrated { silence }, range { 0.0f }, truePeak { silence };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessMeter)
+};
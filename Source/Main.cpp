@@ -1,5 +1,11 @@
 #include <JuceHeader.h>
 #include "UnixMatrix.h"
+#include "DrawProfiler.h"
+#include "PlayerGrid.h"
+#include "RemoteControl.h"
+#include "PlayerPlugin.h"
+#include "PluginScanner.h"
+#include "EngineTest.h"
 
 class Application    : public juce::JUCEApplication
 {
@@ -10,12 +16,112 @@ public:
     const juce::String getApplicationName() override       { return "PlayingSoundFilesTutorial"; }
     const juce::String getApplicationVersion() override    { return "1.0.0"; }
 
-    void initialise (const juce::String&) override
+    void initialise (const juce::String& commandLine) override
     {
-        mainWindow.reset (new MainWindow ("UnixMatrix", std::make_unique<MainContentComponent>(), *this));
+        // Child process scanning plug-ins for the main app: no window
+        if ((scanWorker = PluginScanWorker::createIfRequested (commandLine)) != nullptr)
+            return;
+
+        if (commandLine.contains ("--profile-drawing"))
+        {
+            DrawProfiler::runAllThemes();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--test-engine"))
+        {
+            setApplicationReturnValue (EngineTest::run (findResourceFile ("cello.wav")));
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-dsp"))
+        {
+            PlaybackDSP::Chain::runBenchmark();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-stretch"))
+        {
+            TimeStretchSource::runBenchmark();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-callback"))
+        {
+            PlayerEngine::runBenchmark();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-sampler"))
+        {
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+
+            if (std::unique_ptr<juce::AudioFormatReader> reader { formats.createReaderFor (findResourceFile ("cello.wav")) })
+                Sampler::runBenchmark (*reader);
+            else
+                juce::Logger::writeToLog ("[sampler] benchmark: Resources/cello.wav not found");
+
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-session"))
+        {
+            SessionStore::runBenchmark();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-record"))
+        {
+            InputRecorder::runBenchmark();
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--benchmark-plugin"))
+        {
+            const auto path = commandLine.fromFirstOccurrenceOf ("--benchmark-plugin", false, false).trim().unquoted();
+            setApplicationReturnValue (PluginBenchmark::run (juce::File::getCurrentWorkingDirectory().getChildFile (path)));
+            quit();
+            return;
+        }
+
+        if (commandLine.contains ("--remote"))
+        {
+            const auto args = juce::StringArray::fromTokens (commandLine.fromFirstOccurrenceOf ("--remote", false, false), true);
+            setApplicationReturnValue (RemoteControlClient::runCommandLine (args));
+            quit();
+            return;
+        }
+
+        // A wall of players, one per channel or zone, sharing decode threads and formats
+        if (commandLine.contains ("--grid"))
+        {
+            const auto numPlayers = commandLine.fromFirstOccurrenceOf ("--grid", false, false).trim().getIntValue();
+            mainWindow.reset (new MainWindow ("UnixMatrix grid", std::make_unique<PlayerGrid> (numPlayers > 0 ? juce::jmin (numPlayers, 256) : 16), *this));
+            return;
+        }
+
+        StartupTrace::begin();
+
+        {
+            StartupTrace::ScopedPhase phase ("main window");
+            mainWindow.reset (new MainWindow ("UnixMatrix", std::make_unique<MainContentComponent>(), *this));
+        }
     }
 
-    void shutdown() override                         { mainWindow = nullptr; }
+    void shutdown() override
+    {
+        mainWindow = nullptr;
+        scanWorker = nullptr;
+    }
 
 private:
     class MainWindow    : public juce::DocumentWindow
@@ -82,6 +188,7 @@ private:
     };
 
     std::unique_ptr<MainWindow> mainWindow;
+    std::unique_ptr<PluginScanWorker> scanWorker;
 };
 
 //==============================================================================
@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+   Old99LookAndFeel.h
+
+   The classic Mac skin's LookAndFeel: bevelled platinum buttons. Shared by
+   the Old99AppleFeel PIP and DrawProfiler, which times it without pulling in
+   the PIP's player.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ButtonSkinCache.h"
+
+class Old99LookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    Old99LookAndFeel()
+    {
+        // Classic Mac OS 9 "Platinum" greys
+        setColour (juce::ResizableWindow::backgroundColourId, juce::Colour (0xffd4d4d4));
+
+        // Default button face
+        setColour (juce::TextButton::buttonColourId, juce::Colour (0xffb5b5b5));
+        setColour (juce::TextButton::textColourOffId, juce::Colours::black);
+        setColour (juce::TextButton::textColourOnId, juce::Colours::black);
+
+        // Labels and text
+        setColour (juce::Label::textColourId, juce::Colours::black);
+        setColour (juce::Label::backgroundColourId, juce::Colour (0x00d4d4d4));
+
+        // Toggle text
+        setColour (juce::ToggleButton::textColourId, juce::Colours::black);
+
+        // Sliders (if any)
+        setColour (juce::Slider::trackColourId, juce::Colour (0xffb0b0b0));
+        setColour (juce::Slider::thumbColourId, juce::Colour (0xff707070));
+    }
+
+    juce::Font getTextButtonFont (juce::TextButton&, int height) override
+    {
+        // Approximate Mac OS 9 feel: Lucida Grande / Charcoal style
+        return juce::Font ("Lucida Grande", (float) height * 0.42f, juce::Font::plain);
+    }
+
+    juce::Font getLabelFont (juce::Label&) override
+    {
+        return juce::Font ("Lucida Grande", 13.0f, juce::Font::plain);
+    }
+
+    void drawButtonBackground (juce::Graphics& g, juce::Button& button,
+                               const juce::Colour& background,
+                               bool isHighlighted, bool isDown) override
+    {
+        buttonSkin.draw (g, button.getLocalBounds(), background,
+                         ButtonSkinCache::getState (button, isHighlighted, isDown));
+    }
+
+    void paintButtonSkin (juce::Graphics& g, juce::Rectangle<float> area,
+                          juce::Colour background, ButtonSkinCache::State state)
+    {
+        auto bounds = area.reduced (0.5f);
+        const bool isDown = state == ButtonSkinCache::State::down;
+
+        auto base = background;
+        if (isDown)
+            base = base.darker (0.25f);
+        else if (state == ButtonSkinCache::State::hover)
+            base = base.brighter (0.08f);
+
+        g.setColour (base);
+        g.fillRect (bounds);
+
+        auto light = juce::Colours::white;
+        auto shadow = juce::Colour (0xff808080);
+        auto darkShadow = juce::Colour (0xff606060);
+
+        if (! isDown)
+        {
+            // top/left highlight, bottom/right shadow
+            g.setColour (light);
+            g.drawLine (bounds.getX(), bounds.getY(), bounds.getRight(), bounds.getY());
+            g.drawLine (bounds.getX(), bounds.getY(), bounds.getX(), bounds.getBottom());
+
+            g.setColour (darkShadow);
+            g.drawLine (bounds.getX(), bounds.getBottom(), bounds.getRight(), bounds.getBottom());
+            g.drawLine (bounds.getRight(), bounds.getY(), bounds.getRight(), bounds.getBottom());
+        }
+        else
+        {
+            // pressed: invert bevel
+            g.setColour (darkShadow);
+            g.drawLine (bounds.getX(), bounds.getY(), bounds.getRight(), bounds.getY());
+            g.drawLine (bounds.getX(), bounds.getY(), bounds.getX(), bounds.getBottom());
+
+            g.setColour (light);
+            g.drawLine (bounds.getX(), bounds.getBottom(), bounds.getRight(), bounds.getBottom());
+            g.drawLine (bounds.getRight(), bounds.getY(), bounds.getRight(), bounds.getBottom());
+        }
+    }
+
+    void drawToggleButton (juce::Graphics& g, juce::ToggleButton& button,
+                           bool isHighlighted, bool isDown) override
+    {
+        auto bounds = button.getLocalBounds().toFloat();
+
+        const float boxSize = 16.0f;
+        juce::Rectangle<float> box (bounds.getX(),
+                                    bounds.getCentreY() - boxSize * 0.5f,
+                                    boxSize,
+                                    boxSize);
+
+        // Box background
+        g.setColour (juce::Colour (0xffb5b5b5));
+        g.fillRect (box);
+
+        // Bevel
+        auto light = juce::Colours::white;
+        auto shadow = juce::Colour (0xff808080);
+        auto darkShadow = juce::Colour (0xff606060);
+
+        g.setColour (light);
+        g.drawLine (box.getX(), box.getY(), box.getRight(), box.getY());
+        g.drawLine (box.getX(), box.getY(), box.getX(), box.getBottom());
+
+        g.setColour (darkShadow);
+        g.drawLine (box.getX(), box.getBottom(), box.getRight(), box.getBottom());
+        g.drawLine (box.getRight(), box.getY(), box.getRight(), box.getBottom());
+
+        // Checkmark when ON
+        if (button.getToggleState())
+        {
+            g.setColour (juce::Colours::black);
+            g.drawLine (box.getX() + 3.0f, box.getCentreY(),
+                        box.getX() + 7.0f, box.getBottom() - 4.0f, 1.5f);
+            g.drawLine (box.getX() + 7.0f, box.getBottom() - 4.0f,
+                        box.getRight() - 3.0f, box.getY() + 3.0f, 1.5f);
+        }
+
+        // Text on the right
+        g.setColour (juce::Colours::black);
+        g.setFont (juce::Font ("Lucida Grande", 13.0f, juce::Font::plain));
+        g.drawText (button.getButtonText(),
+                    box.getRight() + 6.0f,
+                    bounds.getY(),
+                    bounds.getWidth() - boxSize - 6.0f,
+                    bounds.getHeight(),
+                    juce::Justification::centredLeft);
+    }
+
+private:
+    // The eight bevel lines are rasterised once per colour, state and scale
+    ButtonSkinCache buttonSkin { 2, [this] (auto& g, auto bounds, auto colour, auto state)
+                                    { paintButtonSkin (g, bounds, colour, state); } };
+};
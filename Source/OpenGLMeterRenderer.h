@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+   OpenGLMeterRenderer.h
+
+   Optional OpenGL path for the level meters: every bar of a series is packed
+   into one vertex buffer and drawn with a single glDrawArrays call, while the
+   buttons and labels keep being painted by JUCE on top of it.
+
+   If the context can't be created or the shaders don't compile, the renderer
+   detaches itself and calls onFallback on the message thread so the owner can
+   go back to drawing in paint().
+
+   On a headless Linux box this runs on Mesa's llvmpipe with
+   LIBGL_ALWAYS_SOFTWARE=1 under Xvfb.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class OpenGLMeterRenderer  : private juce::OpenGLRenderer
+{
+public:
+    static constexpr int maxBars = 1024;
+
+    explicit OpenGLMeterRenderer (juce::Component& componentToDrawOn)
+        : target (componentToDrawOn)
+    {
+        context.setRenderer (this);
+        context.setComponentPaintingEnabled (true);
+        context.setContinuousRepainting (false);
+    }
+
+    ~OpenGLMeterRenderer() override
+    {
+        context.detach();
+    }
+
+    /** Attaches or detaches the GL context. Returns the new state. */
+    bool setEnabled (bool shouldBeEnabled)
+    {
+        if (shouldBeEnabled == isEnabled())
+            return isEnabled();
+
+        if (shouldBeEnabled)
+        {
+            contextCreated = false;
+            context.attachTo (target);
+
+            // Some drivers never call back at all; don't leave the meters blank
+            juce::Timer::callAfterDelay (1000, [weakThis = juce::WeakReference<OpenGLMeterRenderer> (this)]
+            {
+                if (auto* r = weakThis.get())
+                    if (r->isEnabled() && ! r->contextCreated)
+                        r->fallBackToSoftware();
+            });
+        }
+        else
+        {
+            context.detach();
+        }
+
+        return isEnabled();
+    }
+
+    bool isEnabled() const noexcept     { return context.isAttached(); }
+
+    /** Called on the message thread after a failure forced a detach. */
+    std::function<void()> onFallback;
+
+    /** Copies a bar series (levels 0..1, oldest first from startIndex) to be
+        drawn inside area, which is in the target component's coordinates.
+    */
+    void setBars (const float* levels, int numLevels, int startIndex,
+                  juce::Rectangle<int> area, juce::Colour colour)
+    {
+        // The ring wraps at numLevels; past maxBars only the newest are drawn
+        const auto numShown = juce::jmin (numLevels, maxBars);
+        const auto firstShown = startIndex + numLevels - numShown;
+
+        {
+            const juce::SpinLock::ScopedLockType sl (snapshotLock);
+
+            for (int i = 0; i < numShown; ++i)
+                snapshot.levels[(size_t) i] = levels[(firstShown + i) % numLevels];
+
+            snapshot.numLevels = numShown;
+            snapshot.area = area.toFloat();
+            snapshot.bounds = target.getLocalBounds().toFloat();
+            snapshot.colour = colour;
+        }
+
+        context.triggerRepaint();
+    }
+
+private:
+    //==============================================================================
+    void newOpenGLContextCreated() override
+    {
+        shader = std::make_unique<juce::OpenGLShaderProgram> (context);
+
+        const auto ok = shader->addVertexShader (juce::OpenGLHelpers::translateVertexShaderToV3 (
+                                                    "attribute vec2 position;\n"
+                                                    "void main()\n"
+                                                    "{\n"
+                                                    "    gl_Position = vec4 (position, 0.0, 1.0);\n"
+                                                    "}\n"))
+                     && shader->addFragmentShader (juce::OpenGLHelpers::translateFragmentShaderToV3 (
+                                                    "uniform " JUCE_MEDIUMP " vec4 colour;\n"
+                                                    "void main()\n"
+                                                    "{\n"
+                                                    "    gl_FragColor = colour;\n"
+                                                    "}\n"))
+                     && shader->link();
+
+        if (! ok)
+        {
+            DBG ("OpenGLMeterRenderer: " << shader->getLastError());
+            shader.reset();
+
+            juce::MessageManager::callAsync ([weakThis = juce::WeakReference<OpenGLMeterRenderer> (this)]
+            {
+                if (auto* r = weakThis.get())
+                    r->fallBackToSoftware();
+            });
+
+            return;
+        }
+
+        positionAttribute = juce::gl::glGetAttribLocation (shader->getProgramID(), "position");
+        colourUniform     = juce::gl::glGetUniformLocation (shader->getProgramID(), "colour");
+
+        juce::gl::glGenBuffers (1, &vertexBuffer);
+        vertices.reserve ((size_t) maxBars * 12);
+        contextCreated = true;
+    }
+
+    void renderOpenGL() override
+    {
+        using namespace juce::gl;
+
+        juce::OpenGLHelpers::clear (juce::Colours::black);
+
+        if (shader == nullptr)
+            return;
+
+        {
+            const juce::SpinLock::ScopedLockType sl (snapshotLock);
+            drawn = snapshot;
+        }
+
+        if (drawn.numLevels <= 0 || drawn.bounds.isEmpty())
+            return;
+
+        buildBarVertices();
+
+        if (vertices.empty())
+            return;
+
+        glEnable (GL_BLEND);
+        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        shader->use();
+        glUniform4f (colourUniform, drawn.colour.getFloatRed(), drawn.colour.getFloatGreen(),
+                                    drawn.colour.getFloatBlue(), drawn.colour.getFloatAlpha());
+
+        glBindBuffer (GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData (GL_ARRAY_BUFFER, (GLsizeiptr) (vertices.size() * sizeof (float)), vertices.data(), GL_STREAM_DRAW);
+
+        glVertexAttribPointer ((GLuint) positionAttribute, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+        glEnableVertexAttribArray ((GLuint) positionAttribute);
+
+        glDrawArrays (GL_TRIANGLES, 0, (GLsizei) (vertices.size() / 2));
+
+        glDisableVertexAttribArray ((GLuint) positionAttribute);
+        glBindBuffer (GL_ARRAY_BUFFER, 0);
+    }
+
+    void openGLContextClosing() override
+    {
+        if (vertexBuffer != 0)
+            juce::gl::glDeleteBuffers (1, &vertexBuffer);
+
+        vertexBuffer = 0;
+        shader.reset();
+    }
+
+    //==============================================================================
+    // Same geometry as the software meters: one bar per level, bottom-aligned.
+    void buildBarVertices()
+    {
+        vertices.clear();
+
+        const auto toX = [w = drawn.bounds.getWidth()]  (float x) { return x / w * 2.0f - 1.0f; };
+        const auto toY = [h = drawn.bounds.getHeight()] (float y) { return 1.0f - y / h * 2.0f; };
+
+        const auto barWidth = drawn.area.getWidth() / (float) drawn.numLevels;
+
+        for (int i = 0; i < drawn.numLevels; ++i)
+        {
+            const auto level = juce::jlimit (0.0f, 1.0f, drawn.levels[(size_t) i]);
+            const auto barH  = std::floor (drawn.area.getHeight() * level);
+
+            if (barH <= 0.0f)
+                continue;
+
+            const auto x0 = toX (drawn.area.getX() + std::floor (barWidth * (float) i));
+            const auto x1 = toX (drawn.area.getX() + std::floor (barWidth * (float) i) + juce::jmax (1.0f, barWidth - 1.0f));
+            const auto y0 = toY (drawn.area.getBottom() - barH);
+            const auto y1 = toY (drawn.area.getBottom());
+
+            for (auto v : { x0, y0,  x1, y0,  x1, y1,
+                            x0, y0,  x1, y1,  x0, y1 })
+                vertices.push_back (v);
+        }
+    }
+
+    void fallBackToSoftware()
+    {
+        context.detach();
+
+        if (onFallback != nullptr)
+            onFallback();
+    }
+
+    //==============================================================================
+    struct Snapshot
+    {
+        std::array<float, maxBars> levels {};
+        int numLevels = 0;
+        juce::Rectangle<float> area, bounds;
+        juce::Colour colour;
+    };
+
+    juce::Component& target;
+    juce::OpenGLContext context;
+
+    juce::SpinLock snapshotLock;
+    Snapshot snapshot, drawn;
+
+    std::unique_ptr<juce::OpenGLShaderProgram> shader;
+    juce::gl::GLint positionAttribute = -1, colourUniform = -1;
+    juce::gl::GLuint vertexBuffer = 0;
+    std::vector<float> vertices;
+
+    std::atomic<bool> contextCreated { false };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (OpenGLMeterRenderer)
+    JUCE_DECLARE_NON_COPYABLE (OpenGLMeterRenderer)
+};
@@ -0,0 +1,832 @@
+/*
+  ==============================================================================
+
+   PlayerEngine.h
+
+   Everything the player does to audio, with no UI and no audio device:
+   reader (through the clip edits) -> time-stretch -> transport -> channel router -> plug-in inserts
+   -> gain -> DSP chain, plus the meters that watch the result.
+
+   Whatever pulls audio (the device callback, or an offline driver pumping
+   fixed-size blocks such as EngineTest) just calls getNextAudioBlock(). Transport commands are
+   queued lock-free and executed at the start of the next block that gets
+   the source lock, so a run with a given block size and command schedule is
+   repeatable to the sample.
+
+   Gain, balance and speed are SmoothedParameters: published from any thread,
+   picked up once per block, ramped on the audio thread. EQ changes glide
+   inside the equaliser instead (see PlaybackDSP.h).
+
+   In sampler mode the transport is bypassed and the loaded file is played
+   polyphonically from MIDI notes instead (see Sampler.h), or a whole folder
+   of samples streamed from disk (see StreamingSampler.h); the router, gain,
+   DSP chain and meters stay the same.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlaybackDSP.h"
+#include "TimeStretchSource.h"
+#include "ChannelRouter.h"
+#include "LoudnessMeter.h"
+#include "Sampler.h"
+#include "StreamingSampler.h"
+#include "InsertChain.h"
+#include "ClipEdits.h"
+
+class PlayerEngine  : public juce::AudioSource,
+                      private juce::ChangeListener,
+                      private juce::AsyncUpdater
+{
+public:
+    enum class State { stopped, starting, playing, paused, stopping };
+
+    struct Listener
+    {
+        virtual ~Listener() = default;
+
+        /** Message thread. */
+        virtual void playerStateChanged (State newState) = 0;
+    };
+
+    /** What crosses to the audio thread; executed at the start of a block. */
+    struct Command
+    {
+        enum class Type { play, pause, stop, seek };
+
+        Type type = Type::stop;
+        double seconds = 0.0;
+
+        /** Set for commands that don't come from the message thread (MIDI, OSC):
+            the state machine follows them instead of initiating them.
+        */
+        bool external = false;
+
+        /** When the input arrived, in Time::getMillisecondCounterHiRes() units;
+            0 = not measured.
+        */
+        double timestampMs = 0.0;
+    };
+
+    explicit PlayerEngine (juce::AudioFormatManager& formats)
+        : formatManager (formats),
+          streamingSampler (formats)
+    {
+        transportSource.addChangeListener (this);
+
+        streamingSampler.onLibraryLoaded = [this] (int numZones, juce::int64)
+        {
+            if (numZones > 0)
+            {
+                numSourceChannels = streamingSampler.getNumChannels();
+                channelRouter.setMatrix (ChannelRouter::Matrix::createDefault (numSourceChannels, numOutputChannels));
+                loudness.reset();
+            }
+        };
+    }
+
+    ~PlayerEngine() override
+    {
+        cancelPendingUpdate();
+        transportSource.removeChangeListener (this);
+        transportSource.setSource (nullptr);
+    }
+
+    /** Message thread, before loadFile(). With a read-ahead thread the file is
+        decoded there into a buffer, and the audio thread never touches the
+        disk; without one (the standalone app) it reads the file directly.
+    */
+    void setReadAheadThread (juce::TimeSliceThread* thread) noexcept    { readAheadThread = thread; }
+
+    /** Message thread, before prepareToPlay. The loudness meter has a worker
+        thread per engine, which a wall of players can do without.
+    */
+    void setLoudnessMeteringEnabled (bool shouldMeter) noexcept         { loudnessMetering = shouldMeter; }
+
+    void addListener (Listener* l)                  { listeners.add (l); }
+    void removeListener (Listener* l)               { listeners.remove (l); }
+
+    //==============================================================================
+    /** Message thread. Replaces the current file; the player ends up stopped. */
+    bool loadFile (const juce::File& file)
+    {
+        std::unique_ptr<juce::AudioFormatReader> fileReader (formatManager.createReaderFor (file));
+
+        if (fileReader == nullptr)
+            return false;
+
+        // Played through the clip edits; a second reader renders their fades
+        auto* reader = new ClipEditReader (std::move (fileReader));
+        clipEditor.attach (reader, std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (file)));
+
+        auto newSource = std::make_unique<juce::AudioFormatReaderSource> (reader, true);
+        const auto numChannels = juce::jlimit (1, ChannelRouter::maxChannels, (int) reader->numChannels);
+        auto newStretch = std::make_unique<TimeStretchSource> (*newSource, numChannels);
+        newStretch->setSpeed (getSpeed());
+        newStretch->setQuality (stretchQuality);
+        newSource->setLooping (looping);
+
+        post ({ Command::Type::stop });
+
+        {
+            // The callback only try-locks this: it outputs silence rather than wait
+            const juce::ScopedLock sl (sourceLock);
+            transportSource.setSource (newStretch.get(), readAheadThread != nullptr ? readAheadSamples : 0,
+                                       readAheadThread, reader->sampleRate, numChannels);
+            stretchSource.reset (newStretch.release());
+            readerSource.reset (newSource.release());
+        }
+
+        numSourceChannels = numChannels;
+        loudness.reset();
+        channelRouter.setMatrix (ChannelRouter::Matrix::createDefault (numChannels, numOutputChannels));
+        currentFile = file;
+
+        if (samplerMode)
+            loadSamplerFromCurrentFile();
+
+        streamingSampler.clearLibrary();
+        changeState (State::stopped);
+        return true;
+    }
+
+    const juce::File& getCurrentFile() const noexcept   { return currentFile; }
+
+    /** Message thread. Trim, split and fade of the current file, heard from
+        the next block read on; the file itself is never modified.
+    */
+    ClipEditor& getClipEditor() noexcept                { return clipEditor; }
+    bool hasFile() const noexcept                       { return readerSource != nullptr; }
+
+    //==============================================================================
+    /** Message thread. Stops the transport and loads the current file into
+        the sampler (up to Sampler::maxSampleSeconds of it), or goes back to
+        plain playback.
+    */
+    void setSamplerMode (bool shouldUseSampler)
+    {
+        if (samplerMode == shouldUseSampler)
+            return;
+
+        if (shouldUseSampler)
+        {
+            stop();
+            loadSamplerFromCurrentFile();
+        }
+        else
+        {
+            allNotesOff();
+        }
+
+        samplerMode = shouldUseSampler;
+    }
+
+    bool isSamplerMode() const noexcept                 { return samplerMode; }
+    Sampler& getSampler() noexcept                      { return sampler; }
+
+    /** Message thread. Switches to sampler mode with a folder of multi-samples
+        streamed from disk; it replaces the single file once loaded (see
+        StreamingSampler for the naming of the files).
+    */
+    void loadLibrary (const juce::File& folder)
+    {
+        setSamplerMode (true);
+        streamingSampler.loadLibrary (folder);
+    }
+
+    bool hasLibrary() const noexcept                    { return streamingSampler.hasLibrary(); }
+
+    // Any thread; played by the library if one is loaded, else by the sampler
+    void noteOn (int note, float velocity) noexcept
+    {
+        if (streamingSampler.hasLibrary())  streamingSampler.noteOn (note, velocity);
+        else                                sampler.noteOn (note, velocity);
+    }
+
+    void noteOff (int note) noexcept
+    {
+        if (streamingSampler.hasLibrary())  streamingSampler.noteOff (note);
+        else                                sampler.noteOff (note);
+    }
+
+    void allNotesOff() noexcept
+    {
+        streamingSampler.allNotesOff();
+        sampler.allNotesOff();
+    }
+
+    int getNumActiveVoices() const noexcept             { return sampler.getNumActiveVoices() + streamingSampler.getNumActiveVoices(); }
+
+    //==============================================================================
+    // Transport, message thread. These drive the state machine; the audio
+    // side of each transition goes through the command queue.
+    void play()
+    {
+        changeState (State::starting);
+    }
+
+    void pause()
+    {
+        post ({ Command::Type::pause });
+        changeState (State::paused);
+    }
+
+    void stop()
+    {
+        post ({ Command::Type::stop });
+        changeState (State::stopped);
+    }
+
+    void seek (double seconds)
+    {
+        post ({ Command::Type::seek, seconds });
+    }
+
+    /** Any thread. Drops the command if nothing has pulled audio for a while
+        and the queue is full.
+    */
+    void post (const Command& command) noexcept
+    {
+        const juce::SpinLock::ScopedLockType sl (commandWriterLock); // the FIFO wants a single writer
+
+        int start1, size1, start2, size2;
+        commandFifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            commands[(size_t) start1] = command;
+            commandFifo.finishedWrite (1);
+        }
+    }
+
+    State getState() const noexcept                     { return state; }
+    bool isPlaying() const noexcept                     { return running.load() && transportSource.isPlaying(); }
+    double getCurrentPosition() const                   { return transportSource.getCurrentPosition(); }
+
+    /** Any thread: the position as of the end of the last block, published by
+        the audio thread. getCurrentPosition() reaches into the sources, which
+        only the message and audio threads may do.
+    */
+    double getPublishedPosition() const noexcept        { return publishedPosition.load (std::memory_order_relaxed); }
+    double getLengthInSeconds() const                   { return transportSource.getLengthInSeconds(); }
+
+    void setLooping (bool shouldLoop)
+    {
+        looping = shouldLoop;
+
+        if (readerSource != nullptr)
+            readerSource->setLooping (shouldLoop);
+    }
+
+    //==============================================================================
+    /** Message thread, from prepareToPlay: how long after the start of a
+        callback its first sample leaves the device.
+    */
+    void setOutputLatency (int latencySamples, double sampleRate) noexcept
+    {
+        outputLatencyMs = sampleRate > 0.0 ? latencySamples * 1000.0 / sampleRate : 0.0;
+    }
+
+    /** Input-to-output delay of timestamped commands: time queued, plus the
+        wait for the next callback, plus the device's output latency.
+    */
+    struct LatencyStats
+    {
+        int count = 0;
+        double totalMs = 0.0, maxMs = 0.0, lastMs = 0.0;
+    };
+
+    LatencyStats getLatencyStats() const noexcept
+    {
+        return { latencyCount.load(), latencyTotalMs.load(), latencyMaxMs.load(), latencyLastMs.load() };
+    }
+
+    /** Delivers any pending state change now. An offline driver with no
+        message loop calls this between blocks to see the same transitions
+        the UI would.
+    */
+    void dispatchPendingUpdates()
+    {
+        transportSource.dispatchPendingMessages();
+        handleUpdateNowIfNeeded();
+    }
+
+    //==============================================================================
+    // Any thread; ramped over rampLengthSeconds on the audio side
+    void setGain (float newGain) noexcept               { parameters.set (gainParameter, newGain); }
+    float getGain() const noexcept                      { return parameters.get (gainParameter); }
+
+    /** -1 = left only, 0 = centre, +1 = right only (first two outputs). */
+    void setPan (float newPan) noexcept                 { parameters.set (panParameter, juce::jlimit (-1.0f, 1.0f, newPan)); }
+    float getPan() const noexcept                       { return parameters.get (panParameter); }
+
+    void setSpeed (double newSpeed) noexcept            { parameters.set (speedParameter, (float) newSpeed); }
+    double getSpeed() const noexcept                    { return parameters.get (speedParameter); }
+
+    /** Message thread. Swaps in a new stretcher, as loadFile() does: with a
+        read-ahead thread the old one is still being pulled from there, so it
+        can't be reallocated in place. Position and play state carry over.
+    */
+    void setStretchQuality (TimeStretchSource::Quality newQuality)
+    {
+        stretchQuality = newQuality;
+
+        if (readerSource == nullptr)
+            return;
+
+        auto* reader = readerSource->getAudioFormatReader();
+        const auto numChannels = juce::jlimit (1, ChannelRouter::maxChannels, (int) reader->numChannels);
+        auto newStretch = std::make_unique<TimeStretchSource> (*readerSource, numChannels);
+        newStretch->setSpeed (getSpeed());
+        newStretch->setQuality (newQuality);
+
+        const juce::ScopedLock sl (sourceLock);
+        const auto position = transportSource.getCurrentPosition();
+        const auto wasPlaying = transportSource.isPlaying();
+
+        // setSource() deletes the old read-ahead buffer, stopping its reads,
+        // before the old stretcher goes
+        transportSource.setSource (newStretch.get(), readAheadThread != nullptr ? readAheadSamples : 0,
+                                   readAheadThread, reader->sampleRate, numChannels);
+        stretchSource.reset (newStretch.release());
+        transportSource.setPosition (position);
+
+        if (wasPlaying)
+            transportSource.start();
+    }
+
+    PlaybackDSP::Chain& getDSPChain() noexcept          { return dspChain; }
+    InsertChain& getInsertChain() noexcept              { return insertChain; }
+    LoudnessMeter& getLoudnessMeter() noexcept          { return loudness; }
+
+    //==============================================================================
+    /** Loudest sample of the last block, all channels. */
+    float getLevel() const noexcept                     { return lastLevel.get(); }
+
+    /** Each reader of the channel peaks gets its own tap, so one consumer
+        resetting a peak doesn't hide it from the other.
+    */
+    enum PeakTap { uiTap, remoteTap, numPeakTaps };
+
+    /** Peak of one output channel since the previous call on the same tap. */
+    float takeChannelPeak (int channel, PeakTap tap = uiTap) noexcept
+    {
+        return channelPeaks[(size_t) tap][(size_t) channel].exchange (0.0f, std::memory_order_relaxed);
+    }
+
+    int getNumSourceChannels() const noexcept           { return numSourceChannels; }
+    int getNumOutputChannels() const noexcept           { return numOutputChannels; }
+
+    /** Live CPU cost on whatever device is open; runBenchmark() measures the
+        callback under fixed conditions instead.
+    */
+    void logProcessingLoad() const
+    {
+        const auto perCore = [] (double load) { return load > 0.0 ? (int) (1.0 / load) : 0; };
+
+        juce::Logger::writeToLog (juce::String::formatted ("[callback] %d -> %d channels: %.2f %% of the block period",
+                                                           numSourceChannels.load(), numOutputChannels.load(),
+                                                           callbackLoad.getLoadAsProportion() * 100.0));
+
+        if (dspChain.isEnabled())
+        {
+            const auto perChannel = dspChain.getLoadPerChannel();
+            juce::Logger::writeToLog (juce::String::formatted ("[dsp] %.3f %% of a core per channel (~%d channels per core)",
+                                                               perChannel * 100.0, perCore (perChannel)));
+        }
+
+        if (stretchSource != nullptr && stretchSource->getSpeed() != 1.0)
+        {
+            const auto perStream = stretchSource->getLoadAsProportion();
+            juce::Logger::writeToLog (juce::String::formatted ("[stretch] %.3f %% of a core per stereo stream (~%d streams per core)",
+                                                               perStream * 100.0, perCore (perStream)));
+        }
+
+        insertChain.logProcessingLoad();
+
+        if (samplerMode && streamingSampler.hasLibrary())
+            streamingSampler.logProcessingLoad();
+        else if (samplerMode)
+            sampler.logProcessingLoad();
+    }
+
+    //==============================================================================
+    /** Plays a file of noise looping, as many outputs as channels, and times
+        the whole callback (read, routing, gain, DSP chain, meters) at 8, 16
+        and 64 channels with a fixed block size and no audio device.
+    */
+    static void runBenchmark (int blockSize = 256, int numBlocks = 2000)
+    {
+        constexpr double benchmarkRate = 48000.0;
+        const auto blockMs = blockSize * 1000.0 / benchmarkRate;
+
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        const auto folder = juce::File::createTempFile ("callback-benchmark");
+        folder.createDirectory();
+
+        for (auto numChannels : { 8, 16, 64 })
+        {
+            const auto file = folder.getChildFile (juce::String (numChannels) + "ch.wav");
+
+            {
+                juce::AudioBuffer<float> noise (numChannels, (int) benchmarkRate * 2);
+                juce::Random random (1);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int i = 0; i < noise.getNumSamples(); ++i)
+                        noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+                std::unique_ptr<juce::OutputStream> stream (file.createOutputStream());
+                std::unique_ptr<juce::AudioFormatWriter> writer (stream == nullptr ? nullptr
+                                                                                    : juce::WavAudioFormat().createWriterFor (stream.get(), benchmarkRate,
+                                                                                                                              (unsigned int) numChannels, 24, {}, 0));
+                if (writer == nullptr)
+                {
+                    juce::Logger::writeToLog ("[callback] benchmark: can't write " + file.getFullPathName());
+                    continue;
+                }
+
+                stream.release(); // now owned by the writer
+                writer->writeFromAudioSampleBuffer (noise, 0, noise.getNumSamples());
+            }
+
+            for (auto withDSP : { false, true })
+            {
+                PlayerEngine engine (formats);
+                engine.setNumOutputChannels (numChannels);
+                engine.prepareToPlay (blockSize, benchmarkRate);
+                engine.getDSPChain().setEnabled (withDSP);
+                engine.setLooping (true);
+
+                if (! engine.loadFile (file))
+                {
+                    juce::Logger::writeToLog ("[callback] benchmark: can't read " + file.getFullPathName());
+                    break;
+                }
+
+                engine.play();
+
+                juce::AudioBuffer<float> buffer (numChannels, blockSize);
+                double totalSeconds = 0.0, maxSeconds = 0.0;
+
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    const juce::AudioSourceChannelInfo info (&buffer, 0, blockSize);
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    engine.getNextAudioBlock (info);
+                    const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+                    totalSeconds += seconds;
+                    maxSeconds = juce::jmax (maxSeconds, seconds);
+                    engine.dispatchPendingUpdates();
+                }
+
+                engine.releaseResources();
+                const auto meanMs = totalSeconds * 1000.0 / numBlocks;
+
+                juce::Logger::writeToLog (juce::String::formatted ("[callback] %2d -> %2d channels%s  mean %6.3f ms, max %6.3f ms per %.2f ms block  (%5.1f %%)",
+                                                                   numChannels, numChannels, withDSP ? " + DSP" : "      ",
+                                                                   meanMs, maxSeconds * 1000.0, blockMs, meanMs * 100.0 / blockMs));
+            }
+        }
+
+        folder.deleteRecursively();
+    }
+
+    //==============================================================================
+    /** Call before prepareToPlay when the device's output count changes. */
+    void setNumOutputChannels (int numOutputs)
+    {
+        numOutputChannels = juce::jlimit (1, ChannelRouter::maxChannels, numOutputs);
+    }
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
+    {
+        sourceBuffer.setSize (ChannelRouter::maxChannels, samplesPerBlockExpected);
+        channelRouter.setMatrix (ChannelRouter::Matrix::createDefault (numSourceChannels, numOutputChannels));
+
+        transportSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
+        parameters.prepare (sampleRate, rampLengthSeconds);
+        dspChain.prepare (sampleRate, samplesPerBlockExpected, numOutputChannels);
+        insertChain.prepare (sampleRate, samplesPerBlockExpected, numOutputChannels);
+        callbackLoad.reset (sampleRate, samplesPerBlockExpected);
+        sampler.prepare (sampleRate, samplesPerBlockExpected);
+        streamingSampler.prepare (sampleRate, samplesPerBlockExpected);
+
+        if (loudnessMetering)
+            loudness.prepare (sampleRate, numOutputChannels);
+    }
+
+    void releaseResources() override
+    {
+        transportSource.releaseResources();
+        insertChain.releaseResources();
+    }
+
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        const juce::AudioProcessLoadMeasurer::ScopedTimer timer (callbackLoad, bufferToFill.numSamples);
+
+        // Commands move the transport, so they only run while the sources
+        // can't be swapped; otherwise they wait for the next block
+        const juce::ScopedTryLock stl (sourceLock);
+        const auto wasRunning = running.load();
+
+        if (stl.isLocked())
+            runPendingCommands();
+
+        const auto isRunning = running.load();
+        parameters.update();
+
+        if (samplerMode)
+        {
+            parameters[speedParameter].skip (bufferToFill.numSamples);
+            sourceBuffer.setSize (numSourceChannels.load(), bufferToFill.numSamples, false, false, true);
+            sourceBuffer.clear();
+            sampler.render (sourceBuffer, 0, bufferToFill.numSamples);
+            streamingSampler.render (sourceBuffer, 0, bufferToFill.numSamples);
+            processOutput (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+            return;
+        }
+
+        if ((! wasRunning && ! isRunning) || ! stl.isLocked() || readerSource == nullptr)
+        {
+            // A rewind without the lock waits for the next block, like the commands
+            if (stl.isLocked())
+            {
+                if (rewindAfterBlock)
+                    transportSource.setPosition (0.0);
+
+                rewindAfterBlock = false;
+                publishedPosition.store (transportSource.getCurrentPosition(), std::memory_order_relaxed);
+            }
+
+            parameters.skip (bufferToFill.numSamples);
+            bufferToFill.clearActiveBufferRegion();
+            lastLevel = 0.0f;
+            return;
+        }
+
+        auto* buffer = bufferToFill.buffer;
+        const int startSample = bufferToFill.startSample;
+        const int numSamples  = bufferToFill.numSamples;
+
+        // A new analysis hop per block is as fine-grained as the stretcher gets.
+        // The ramp ends exactly on its target, so a return to 1.0 lands on the
+        // stretcher's pass-through, which picks up at its current read point.
+        stretchSource->setSpeed (parameters[speedParameter].skip (numSamples));
+
+        // Le transport rend dans le nombre de canaux du fichier, puis la
+        // matrice les répartit sur les sorties de la carte.
+        sourceBuffer.setSize (numSourceChannels.load(), numSamples, false, false, true);
+        juce::AudioSourceChannelInfo sourceInfo (sourceBuffer);
+        transportSource.getNextAudioBlock (sourceInfo);
+
+        // Same de-click as AudioTransportSource::start() / stop()
+        if (wasRunning != isRunning)
+            sourceBuffer.applyGainRamp (0, numSamples, isRunning ? 0.0f : 1.0f, isRunning ? 1.0f : 0.0f);
+
+        if (rewindAfterBlock)
+            transportSource.setPosition (0.0);
+
+        rewindAfterBlock = false;
+        publishedPosition.store (transportSource.getCurrentPosition(), std::memory_order_relaxed);
+
+        processOutput (*buffer, startSample, numSamples);
+    }
+
+private:
+    //==============================================================================
+    enum { gainParameter, panParameter, speedParameter, numParameters };
+    static constexpr double rampLengthSeconds = 0.05;
+    static constexpr int rampStep = 32;
+
+    /** sourceBuffer -> router -> inserts -> gain -> DSP chain -> meters. */
+    void processOutput (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        channelRouter.process (sourceBuffer, buffer, startSample, numSamples);
+        insertChain.process (buffer, startSample, numSamples);
+
+        applyGainAndBalance (buffer, startSample, numSamples);
+        dspChain.process (buffer, startSample, numSamples);
+        loudness.pushBlock (buffer, startSample, numSamples); // simple copie, le calcul se fait ailleurs
+
+        // Crête par canal (getMagnitude est vectorisé), gardée jusqu'à la
+        // prochaine image de l'interface
+        const int numChannels = juce::jmin (buffer.getNumChannels(), ChannelRouter::maxChannels);
+        float maxSample = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto peak = buffer.getMagnitude (ch, startSample, numSamples);
+
+            for (auto& tap : channelPeaks)
+            {
+                auto& held = tap[(size_t) ch];
+
+                if (peak > held.load (std::memory_order_relaxed))
+                    held.store (peak, std::memory_order_relaxed);
+            }
+
+            maxSample = juce::jmax (maxSample, peak);
+        }
+
+        lastLevel = maxSample;
+    }
+
+    /** Gain and balance ramp linearly over sub-blocks of rampStep samples, so
+        the per-sample work is one multiply per channel.
+    */
+    void applyGainAndBalance (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        auto& gain = parameters[gainParameter];
+        auto& pan  = parameters[panParameter];
+        const auto numChannels = buffer.getNumChannels();
+
+        if (! gain.isSmoothing() && ! pan.isSmoothing())
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                if (const auto g = gain.getTargetValue() * PlaybackDSP::getBalanceGain (ch, numChannels, pan.getTargetValue()); g != 1.0f)
+                    buffer.applyGain (ch, startSample, numSamples, g);
+
+            return;
+        }
+
+        for (int pos = 0; pos < numSamples; pos += rampStep)
+        {
+            const auto num = juce::jmin (rampStep, numSamples - pos);
+            const auto gain0 = gain.getCurrentValue(), pan0 = pan.getCurrentValue();
+            const auto gain1 = gain.skip (num),        pan1 = pan.skip (num);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.applyGainRamp (ch, startSample + pos, num,
+                                      gain0 * PlaybackDSP::getBalanceGain (ch, numChannels, pan0),
+                                      gain1 * PlaybackDSP::getBalanceGain (ch, numChannels, pan1));
+        }
+    }
+
+    //==============================================================================
+    // The transport is left running and playback is gated here instead:
+    // AudioTransportSource::stop() waits for the next callback, so it can't
+    // be called from the callback itself. Called with sourceLock held.
+    void runPendingCommands() noexcept
+    {
+        const auto numReady = commandFifo.getNumReady();
+
+        if (numReady == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        commandFifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+        const auto nowMs = juce::Time::getMillisecondCounterHiRes();
+
+        for (int i = 0; i < size1 + size2; ++i)
+        {
+            const auto& command = commands[(size_t) (i < size1 ? start1 + i : start2 + i - size1)];
+
+            switch (command.type)
+            {
+                case Command::Type::play:
+                    running = true;
+                    transportSource.start();
+                    break;
+
+                case Command::Type::pause:
+                    running = false;
+                    break;
+
+                case Command::Type::stop:
+                    running = false;
+                    rewindAfterBlock = true; // after the fade-out block
+                    break;
+
+                case Command::Type::seek:
+                    rewindAfterBlock = false;
+                    transportSource.setPosition (command.seconds);
+                    break;
+            }
+
+            if (command.external && command.type != Command::Type::seek)
+                externalState = (int) (command.type == Command::Type::play  ? (transportSource.isPlaying() ? State::playing : State::stopped)
+                                     : command.type == Command::Type::pause ? State::paused
+                                                                            : State::stopped);
+
+            if (command.timestampMs > 0.0)
+                recordLatency (nowMs - command.timestampMs + outputLatencyMs.load());
+        }
+
+        commandFifo.finishedRead (size1 + size2);
+        triggerAsyncUpdate();
+    }
+
+    void loadSamplerFromCurrentFile()
+    {
+        if (std::unique_ptr<juce::AudioFormatReader> reader { formatManager.createReaderFor (currentFile) })
+            sampler.loadSample (*reader);
+        else
+            sampler.clearSample();
+    }
+
+    void recordLatency (double latencyMs) noexcept
+    {
+        // Single writer (the audio thread), so plain load/store is enough
+        latencyLastMs = latencyMs;
+        latencyTotalMs = latencyTotalMs.load() + latencyMs;
+        latencyMaxMs = juce::jmax (latencyMaxMs.load(), latencyMs);
+        ++latencyCount;
+    }
+
+    void changeListenerCallback (juce::ChangeBroadcaster*) override     { transportStateChanged(); }
+
+    void handleAsyncUpdate() override
+    {
+        // An external controller already moved the transport; just follow it
+        if (const auto followed = externalState.exchange (-1); followed >= 0)
+            changeState ((State) followed);
+
+        transportStateChanged();
+    }
+
+    // Paused and stopped are entered from the message thread and stay put;
+    // the audio side only confirms a start, or reports the end of the file.
+    void transportStateChanged()
+    {
+        if (state == State::starting && isPlaying())
+            changeState (State::playing);
+        else if ((state == State::playing || state == State::stopping) && ! isPlaying())
+            changeState (State::stopped);
+    }
+
+    void changeState (State newState)
+    {
+        if (state == newState)
+            return;
+
+        state = newState;
+
+        switch (state)
+        {
+            case State::stopped:    post ({ Command::Type::stop }); break;
+            case State::starting:   post ({ Command::Type::play }); break;
+            case State::stopping:   post ({ Command::Type::pause }); break;
+            case State::playing:
+            case State::paused:     break;
+        }
+
+        listeners.call ([newState] (Listener& l) { l.playerStateChanged (newState); });
+    }
+
+    //==============================================================================
+    juce::AudioFormatManager& formatManager;
+    juce::File currentFile;
+
+    ClipEditor clipEditor;
+    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    std::unique_ptr<TimeStretchSource> stretchSource;
+    juce::AudioTransportSource transportSource;
+    ChannelRouter channelRouter;
+    juce::AudioBuffer<float> sourceBuffer;
+    std::atomic<int> numSourceChannels { 2 }, numOutputChannels { 2 };
+    PlaybackDSP::Chain dspChain;
+    InsertChain insertChain;
+    juce::AudioProcessLoadMeasurer callbackLoad;
+    LoudnessMeter loudness;
+    Sampler sampler;
+    StreamingSampler streamingSampler;
+    std::atomic<bool> samplerMode { false };
+
+    juce::CriticalSection sourceLock; // guards swapping or reallocating the sources
+    SmoothedParameters<numParameters> parameters { { 1.0f, 0.0f, 1.0f } };
+    TimeStretchSource::Quality stretchQuality = TimeStretchSource::Quality::normal;
+    bool looping = false;
+
+    static constexpr int readAheadSamples = 32768;
+    juce::TimeSliceThread* readAheadThread = nullptr;
+    bool loudnessMetering = true;
+
+    static constexpr int commandQueueSize = 64;
+    juce::AbstractFifo commandFifo { commandQueueSize };
+    std::array<Command, commandQueueSize> commands {};
+    juce::SpinLock commandWriterLock;
+    std::atomic<bool> running { false }; // audio thread writes, anyone reads
+    std::atomic<int> externalState { -1 };
+    bool rewindAfterBlock = false;
+    std::atomic<double> publishedPosition { 0.0 };
+
+    juce::Atomic<float> lastLevel { 0.0f };
+
+    std::atomic<double> outputLatencyMs { 0.0 };
+    std::atomic<int> latencyCount { 0 };
+    std::atomic<double> latencyTotalMs { 0.0 }, latencyMaxMs { 0.0 }, latencyLastMs { 0.0 };
+    std::array<std::array<std::atomic<float>, ChannelRouter::maxChannels>, numPeakTaps> channelPeaks {};
+
+    State state = State::stopped;
+    juce::ListenerList<Listener> listeners;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerEngine)
+};
@@ -0,0 +1,263 @@
+/*
+  ==============================================================================
+
+   PlayerGrid.h
+
+   A wall of players in one process, one per channel or zone: --grid N.
+
+   Each tile has its own PlayerEngine; everything else is shared:
+     - one AudioFormatManager, its formats registered once,
+     - a small pool of read-ahead threads decoding for all the players,
+     - one UI timer refreshing every tile (a tile repaints only when its
+       level or position has visibly moved),
+     - one device callback, the players summed by a MixerAudioSource.
+
+   Loudness metering is off in the tiles (it has a thread per engine), so
+   the thread count is the pool size whatever the number of players.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlayerEngine.h"
+
+/** The formats, registered by whichever grid asks first. */
+struct SharedAudioFormats
+{
+    SharedAudioFormats()    { formats.registerBasicFormats(); }
+
+    juce::AudioFormatManager formats;
+};
+
+//==============================================================================
+/** A few TimeSliceThreads shared round-robin between the players; each
+    thread serves the read-ahead buffers of many files in turn.
+*/
+class ReadAheadPool
+{
+public:
+    explicit ReadAheadPool (int numThreads)
+    {
+        for (int i = 0; i < juce::jmax (1, numThreads); ++i)
+        {
+            auto* thread = threads.add (new juce::TimeSliceThread ("Read-ahead " + juce::String (i + 1)));
+            thread->startThread (juce::Thread::Priority::high);
+        }
+    }
+
+    ~ReadAheadPool()
+    {
+        for (auto* thread : threads)
+            thread->stopThread (2000);
+    }
+
+    juce::TimeSliceThread& next() noexcept      { return *threads[nextIndex++ % threads.size()]; }
+
+private:
+    juce::OwnedArray<juce::TimeSliceThread> threads;
+    int nextIndex = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ReadAheadPool)
+};
+
+//==============================================================================
+class PlayerTile  : public juce::Component,
+                    private PlayerEngine::Listener
+{
+public:
+    PlayerTile (int index, juce::AudioFormatManager& formats, juce::TimeSliceThread& readAheadThread)
+        : engine (formats),
+          formatManager (formats)
+    {
+        engine.setReadAheadThread (&readAheadThread);
+        engine.setLoudnessMeteringEnabled (false);
+        engine.setLooping (true);
+        engine.addListener (this);
+
+        addAndMakeVisible (openButton);
+        openButton.setButtonText (juce::String (index + 1));
+        openButton.onClick = [this] { openButtonClicked(); };
+
+        addAndMakeVisible (playButton);
+        playButton.setButtonText ("Play");
+        playButton.setEnabled (false);
+        playButton.onClick = [this]
+        {
+            if (engine.getState() == PlayerEngine::State::playing || engine.getState() == PlayerEngine::State::starting)
+                engine.stop();
+            else
+                engine.play();
+        };
+    }
+
+    ~PlayerTile() override
+    {
+        engine.removeListener (this);
+    }
+
+    PlayerEngine& getEngine() noexcept          { return engine; }
+
+    /** From the grid's timer. */
+    void refresh()
+    {
+        const auto level = engine.getLevel();
+        const auto length = engine.getLengthInSeconds();
+        const auto position = length > 0.0 ? (float) (engine.getCurrentPosition() / length) : 0.0f;
+
+        // Under a pixel of change isn't worth a repaint
+        const auto width = (float) juce::jmax (1, getWidth());
+
+        if (std::abs (level - shownLevel) * width >= 1.0f || std::abs (position - shownPosition) * width >= 1.0f)
+        {
+            shownLevel = level;
+            shownPosition = position;
+            repaint();
+        }
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().reduced (2);
+        g.setColour (findColour (juce::TextButton::buttonColourId).darker (0.5f));
+        g.fillRect (area);
+
+        auto bars = area.removeFromBottom (10);
+        g.setColour (findColour (juce::TextButton::textColourOffId));
+        g.fillRect (bars.removeFromTop (4).withWidth (juce::roundToInt ((float) bars.getWidth() * shownPosition)));
+        bars.removeFromTop (2);
+        g.fillRect (bars.withWidth (juce::roundToInt ((float) bars.getWidth() * juce::jmin (1.0f, shownLevel))));
+
+        g.setFont (juce::FontOptions (11.0f));
+        g.drawFittedText (engine.getCurrentFile().getFileNameWithoutExtension(),
+                          area.reduced (4, 0).removeFromBottom (14), juce::Justification::centredLeft, 1);
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (4).removeFromTop (22);
+        openButton.setBounds (area.removeFromLeft (area.getWidth() / 2 - 2));
+        area.removeFromLeft (4);
+        playButton.setBounds (area);
+    }
+
+private:
+    void playerStateChanged (PlayerEngine::State newState) override
+    {
+        const auto running = newState == PlayerEngine::State::playing || newState == PlayerEngine::State::starting;
+        playButton.setButtonText (running ? "Stop" : "Play");
+    }
+
+    void openButtonClicked()
+    {
+        chooser = std::make_unique<juce::FileChooser> ("Select an audio file for this player...",
+                                                       juce::File{},
+                                                       formatManager.getWildcardForAllFormats());
+
+        chooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& fc)
+        {
+            if (fc.getResult() != juce::File{} && engine.loadFile (fc.getResult()))
+            {
+                playButton.setEnabled (true);
+                repaint();
+            }
+        });
+    }
+
+    PlayerEngine engine;
+    juce::AudioFormatManager& formatManager;
+    juce::TextButton openButton, playButton;
+    std::unique_ptr<juce::FileChooser> chooser;
+    float shownLevel = 0.0f, shownPosition = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerTile)
+};
+
+//==============================================================================
+class PlayerGrid  : public juce::AudioAppComponent,
+                    private juce::Timer
+{
+public:
+    static constexpr int tileWidth = 150, tileHeight = 64;
+
+    explicit PlayerGrid (int numPlayers)
+        : readAheadPool (juce::jlimit (1, 4, juce::SystemStats::getNumCpus() / 2))
+    {
+        setLookAndFeel (&theme);
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            auto* tile = tiles.add (new PlayerTile (i, sharedFormats->formats, readAheadPool.next()));
+            addAndMakeVisible (tile);
+            mixer.addInputSource (&tile->getEngine(), false);
+        }
+
+        columns = juce::jmax (1, (int) std::ceil (std::sqrt ((double) numPlayers)));
+        const auto rows = (numPlayers + columns - 1) / columns;
+        setSize (juce::jmin (1600, columns * tileWidth), juce::jmin (1000, rows * tileHeight));
+
+        setAudioChannels (0, 2);
+        startTimerHz (30);
+    }
+
+    ~PlayerGrid() override
+    {
+        stopTimer();
+        shutdownAudio();
+        mixer.removeAllInputs();
+        setLookAndFeel (nullptr);
+    }
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
+    {
+        auto* device = deviceManager.getCurrentAudioDevice();
+        const auto numOutputs = device != nullptr ? device->getActiveOutputChannels().countNumberOfSetBits() : 2;
+
+        for (auto* tile : tiles)
+            tile->getEngine().setNumOutputChannels (numOutputs);
+
+        mixer.prepareToPlay (samplesPerBlockExpected, sampleRate);
+    }
+
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        mixer.getNextAudioBlock (bufferToFill);
+    }
+
+    void releaseResources() override
+    {
+        mixer.releaseResources();
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (findColour (juce::ResizableWindow::backgroundColourId));
+    }
+
+    void resized() override
+    {
+        const auto width = getWidth() / columns;
+        const auto height = juce::jmax (tileHeight, getHeight() / juce::jmax (1, (tiles.size() + columns - 1) / columns));
+
+        for (int i = 0; i < tiles.size(); ++i)
+            tiles[i]->setBounds ((i % columns) * width, (i / columns) * height, width, height);
+    }
+
+private:
+    // Une seule horloge pour toute la grille, au lieu d'un Timer par lecteur
+    void timerCallback() override
+    {
+        for (auto* tile : tiles)
+            tile->refresh();
+    }
+
+    UnixMatrixLookAndFeel theme;
+    juce::SharedResourcePointer<SharedAudioFormats> sharedFormats;
+    ReadAheadPool readAheadPool;            // outlives the tiles' buffering sources
+    juce::OwnedArray<PlayerTile> tiles;
+    juce::MixerAudioSource mixer;
+    int columns = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerGrid)
+};
@@ -0,0 +1,417 @@
+/*
+  ==============================================================================
+
+   PlayerPlugin.h
+
+   The player as an audio plug-in (VST3, LV2): the same PlayerEngine, with
+   playback following the host transport instead of the Play/Stop buttons.
+
+   The file is decoded ahead on a TimeSliceThread, so processBlock() does no
+   disk access or allocation of its own. Host start/stop and position changes
+   become engine commands, which are applied at the top of the same block.
+   It does take two short locks when the host transport moves: the engine's
+   command SpinLock while posting, and the AudioTransportSource callback lock
+   in start() and setPosition(). Only the message thread contends for them,
+   when the engine posts its own state changes or a file swap replaces the
+   transport's source, and each is held for a few instructions.
+
+   The file starts at the host's time zero. While the host plays, the file
+   is re-seeked whenever it drifts more than a couple of blocks from the
+   host position, e.g. after a locate or on each loop round.
+
+   PluginBenchmark drives the processor from a fake host play head, with no
+   audio device and no window. Start the standalone app with
+   --benchmark-plugin <file> to run it.
+
+  ==============================================================================
+*/
+
+/*******************************************************************************
+ The block below describes the properties of this PIP. A PIP is a short snippet
+ of code that can be read by the Projucer and used to generate a JUCE project.
+
+ BEGIN_JUCE_PIP_METADATA
+
+ name:               UnixMatrixPlayerPlugin
+ version:            1.0.0
+ vendor:             JUCE
+ website:            http://juce.com
+ description:        Plays an audio file in sync with the host transport.
+
+ dependencies:       juce_audio_basics, juce_audio_devices, juce_audio_formats,
+                     juce_audio_plugin_client, juce_audio_processors,
+                     juce_audio_utils, juce_core, juce_data_structures,
+                     juce_dsp, juce_events, juce_graphics, juce_gui_basics,
+                     juce_gui_extra
+ exporters:          xcode_mac, vs2019, linux_make
+
+ moduleFlags:        JUCE_STRICT_REFCOUNTEDPOINTER=1
+
+ type:               AudioProcessor
+ mainClass:          PlayerPluginProcessor
+ extraPluginFormats: LV2
+
+ useLocalCopy:       1
+
+ END_JUCE_PIP_METADATA
+
+*******************************************************************************/
+
+#pragma once
+
+#include "PlayerEngine.h"
+
+class PlayerPluginProcessor  : public juce::AudioProcessor
+{
+public:
+    PlayerPluginProcessor()
+        : AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true))
+    {
+        formatManager.registerBasicFormats();
+        engine.setReadAheadThread (&readAheadThread);
+        readAheadThread.startThread (juce::Thread::Priority::high);
+
+        addParameter (gain = new juce::AudioParameterFloat ({ "gain", 1 }, "Gain", 0.0f, 1.0f, 1.0f));
+    }
+
+    ~PlayerPluginProcessor() override
+    {
+        engine.releaseResources();
+    }
+
+    //==============================================================================
+    /** Message thread. */
+    bool loadFile (const juce::File& file)
+    {
+        if (! engine.loadFile (file))
+            return false;
+
+        resyncRequested = true; // the next block re-seeks and restarts if the host is playing
+        sendChangeMessageToEditor();
+        return true;
+    }
+
+    const juce::File& getCurrentFile() const noexcept   { return engine.getCurrentFile(); }
+    PlayerEngine& getEngine() noexcept                  { return engine; }
+    juce::AudioParameterFloat& getGainParameter()       { return *gain; }
+
+    std::function<void()> onFileChanged; // message thread, for the editor
+
+    //==============================================================================
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override
+    {
+        const auto& out = layouts.getMainOutputChannelSet();
+        return out == juce::AudioChannelSet::mono() || out == juce::AudioChannelSet::stereo();
+    }
+
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override
+    {
+        hostSampleRate = sampleRate;
+        resyncToleranceSeconds = juce::jmax (0.02, 2.0 * samplesPerBlock / sampleRate);
+
+        engine.setNumOutputChannels (getTotalNumOutputChannels());
+        engine.prepareToPlay (samplesPerBlock, sampleRate);
+        engine.setOutputLatency (samplesPerBlock, sampleRate);
+    }
+
+    void releaseResources() override
+    {
+        engine.releaseResources();
+    }
+
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
+    {
+        const juce::ScopedNoDenormals noDenormals;
+
+        engine.setGain (gain->get());
+        followHostTransport();
+
+        const juce::AudioSourceChannelInfo info (buffer);
+        engine.getNextAudioBlock (info);
+    }
+
+    using AudioProcessor::processBlock;
+
+    //==============================================================================
+    bool hasEditor() const override                     { return true; }
+    juce::AudioProcessorEditor* createEditor() override;
+
+    const juce::String getName() const override         { return "UnixMatrixPlayerPlugin"; }
+    bool acceptsMidi() const override                   { return false; }
+    bool producesMidi() const override                  { return false; }
+    double getTailLengthSeconds() const override        { return 0.0; }
+
+    int getNumPrograms() override                       { return 1; }
+    int getCurrentProgram() override                    { return 0; }
+    void setCurrentProgram (int) override               {}
+    const juce::String getProgramName (int) override    { return {}; }
+    void changeProgramName (int, const juce::String&) override {}
+
+    void getStateInformation (juce::MemoryBlock& destData) override
+    {
+        juce::XmlElement state ("UNIXMATRIXPLAYER");
+        state.setAttribute ("file", getCurrentFile().getFullPathName());
+        state.setAttribute ("gain", (double) gain->get());
+        copyXmlToBinary (state, destData);
+    }
+
+    void setStateInformation (const void* data, int sizeInBytes) override
+    {
+        const auto state = getXmlFromBinary (data, sizeInBytes);
+
+        if (state == nullptr || ! state->hasTagName ("UNIXMATRIXPLAYER"))
+            return;
+
+        *gain = (float) state->getDoubleAttribute ("gain", 1.0);
+
+        // Some hosts restore state off the message thread; the file swap must not be,
+        // as loadFile() reallocates the sources, so it goes to the message thread
+        const auto file = juce::File (state->getStringAttribute ("file"));
+
+        if (file.existsAsFile())
+            juce::MessageManager::callAsync ([safeThis = juce::WeakReference<PlayerPluginProcessor> (this), file]
+            {
+                if (safeThis != nullptr)
+                    safeThis->loadFile (file);
+            });
+    }
+
+private:
+    using Command = PlayerEngine::Command;
+
+    // Audio thread. Commands are flagged external so the engine's state
+    // machine follows the host instead of driving playback itself.
+    void followHostTransport() noexcept
+    {
+        juce::Optional<juce::AudioPlayHead::PositionInfo> position;
+
+        if (auto* playHead = getPlayHead())
+            position = playHead->getPosition();
+
+        const auto hostPlaying = position.hasValue() && position->getIsPlaying();
+
+        if (resyncRequested.exchange (false))
+            filePlaying = false;
+
+        if (! hostPlaying)
+        {
+            if (hostWasPlaying)
+                post (Command::Type::pause);
+
+            hostWasPlaying = false;
+            return;
+        }
+
+        const auto hostSeconds = position->getTimeInSeconds()
+                                    .orFallback ((double) position->getTimeInSamples().orFallback (0) / hostSampleRate);
+        const auto inFile = hostSeconds >= 0.0 && hostSeconds < engine.getLengthInSeconds();
+
+        if (! inFile)
+        {
+            if (hostWasPlaying && filePlaying)
+                post (Command::Type::pause);
+
+            filePlaying = false;
+        }
+        else
+        {
+            if (! hostWasPlaying || ! filePlaying || std::abs (engine.getCurrentPosition() - hostSeconds) > resyncToleranceSeconds)
+                post (Command::Type::seek, hostSeconds);
+
+            if (! hostWasPlaying || ! filePlaying)
+                post (Command::Type::play);
+
+            filePlaying = true;
+        }
+
+        hostWasPlaying = true;
+    }
+
+    void post (Command::Type type, double seconds = 0.0) noexcept
+    {
+        Command command;
+        command.type = type;
+        command.seconds = seconds;
+        command.external = true;
+        engine.post (command);
+
+        if (type == Command::Type::pause)
+            filePlaying = false;
+    }
+
+    void sendChangeMessageToEditor()
+    {
+        if (onFileChanged != nullptr)
+            onFileChanged();
+    }
+
+    //==============================================================================
+    juce::AudioFormatManager formatManager;
+    juce::TimeSliceThread readAheadThread { "Plugin read-ahead" };
+    PlayerEngine engine { formatManager };
+    juce::AudioParameterFloat* gain = nullptr;
+
+    double hostSampleRate = 44100.0, resyncToleranceSeconds = 0.02;
+    bool hostWasPlaying = false, filePlaying = false;
+    std::atomic<bool> resyncRequested { false };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (PlayerPluginProcessor)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerPluginProcessor)
+};
+
+//==============================================================================
+class PlayerPluginEditor  : public juce::AudioProcessorEditor
+{
+public:
+    explicit PlayerPluginEditor (PlayerPluginProcessor& p)
+        : AudioProcessorEditor (p), processor (p),
+          gainAttachment (p.getGainParameter(), gainSlider)
+    {
+        addAndMakeVisible (openButton);
+        openButton.setButtonText ("Open...");
+        openButton.onClick = [this] { openButtonClicked(); };
+
+        addAndMakeVisible (fileLabel);
+        fileLabel.setJustificationType (juce::Justification::centredLeft);
+
+        addAndMakeVisible (gainSlider);
+        gainSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+        gainSlider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 60, 20);
+
+        processor.onFileChanged = [this] { updateFileLabel(); };
+        updateFileLabel();
+
+        setSize (300, 91);
+    }
+
+    ~PlayerPluginEditor() override
+    {
+        processor.onFileChanged = nullptr;
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+    }
+
+    void resized() override
+    {
+        const int margin = 10;
+        const int h      = 22;
+        const int gap    = 5;
+        int y = margin;
+
+        openButton.setBounds (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+        fileLabel.setBounds  (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+        gainSlider.setBounds (margin, y, getWidth() - 2 * margin, h);
+    }
+
+private:
+    void openButtonClicked()
+    {
+        chooser = std::make_unique<juce::FileChooser> ("Select an audio file to play...", juce::File{}, "*.wav;*.aif;*.aiff;*.flac;*.ogg;*.mp3");
+
+        chooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& fc)
+        {
+            if (const auto file = fc.getResult(); file != juce::File{})
+                processor.loadFile (file);
+        });
+    }
+
+    void updateFileLabel()
+    {
+        const auto& file = processor.getCurrentFile();
+        fileLabel.setText (file == juce::File{} ? "No file" : file.getFileName(), juce::dontSendNotification);
+    }
+
+    PlayerPluginProcessor& processor;
+    juce::TextButton openButton;
+    juce::Label fileLabel;
+    juce::Slider gainSlider;
+    juce::SliderParameterAttachment gainAttachment;
+    std::unique_ptr<juce::FileChooser> chooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlayerPluginEditor)
+};
+
+inline juce::AudioProcessorEditor* PlayerPluginProcessor::createEditor()
+{
+    return new PlayerPluginEditor (*this);
+}
+
+//==============================================================================
+/** Headless host: a fake play head, fixed-size blocks paced in real time,
+    and a locate, a stop and a restart along the way. The processing cost of
+    every block is timed. Lines look like:
+        [plugin] 2000 blocks of 128 @ 48000 Hz: mean 18.4 us, max 96.1 us (3.6 % of 2.67 ms)
+*/
+class PluginBenchmark
+{
+public:
+    static int run (const juce::File& file, int numBlocks = 2000, int blockSize = 128, double sampleRate = 48000.0)
+    {
+        PlayerPluginProcessor processor;
+        HostPlayHead playHead;
+        processor.setPlayHead (&playHead);
+        processor.setPlayConfigDetails (0, 2, sampleRate, blockSize);
+        processor.prepareToPlay (sampleRate, blockSize);
+
+        if (! processor.loadFile (file))
+        {
+            juce::Logger::writeToLog ("[plugin] can't open " + file.getFullPathName());
+            return 1;
+        }
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        juce::MidiBuffer midi;
+        const auto blockMs = blockSize * 1000.0 / sampleRate;
+        double totalUs = 0.0, maxUs = 0.0;
+        auto deadline = juce::Time::getMillisecondCounterHiRes();
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            // Host actions: play, locate at 1/4, stop at 1/2, play again at 5/8
+            playHead.playing = block < numBlocks / 2 || block >= numBlocks * 5 / 8;
+
+            if (block == numBlocks / 4)
+                playHead.timeInSamples = (juce::int64) (sampleRate * 0.5);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (buffer, midi);
+            const auto us = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) * 1.0e6;
+
+            totalUs += us;
+            maxUs = juce::jmax (maxUs, us);
+
+            if (playHead.playing)
+                playHead.timeInSamples += blockSize;
+
+            // Leave the read-ahead thread the same time a real device would
+            deadline += blockMs;
+            juce::Thread::sleep (juce::jmax (0, (int) (deadline - juce::Time::getMillisecondCounterHiRes())));
+            processor.getEngine().dispatchPendingUpdates();
+        }
+
+        juce::Logger::writeToLog (juce::String::formatted ("[plugin] %d blocks of %d @ %.0f Hz: mean %.1f us, max %.1f us (%.1f %% of %.2f ms)",
+                                                           numBlocks, blockSize, sampleRate, totalUs / numBlocks, maxUs,
+                                                           maxUs * 0.1 / blockMs, blockMs));
+        processor.releaseResources();
+        return 0;
+    }
+
+private:
+    struct HostPlayHead  : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying (playing);
+            info.setTimeInSamples (timeInSamples);
+            return info;
+        }
+
+        bool playing = false;
+        juce::int64 timeInSamples = 0;
+    };
+};
@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+   PluginScanner.h
+
+   Finds the installed effect plug-ins without risking the player.
+
+   Each plug-in file is loaded in a child copy of this executable, started
+   with a private command-line ID. A plug-in that crashes or hangs while
+   being scanned takes down the worker, not the app. The file is then
+   recorded as failed and a fresh worker carries on with the next one.
+
+   The scan runs on a low-priority background thread once the window is up.
+   What is found is cached to disk, so the next launch lists the plug-ins
+   straight away and only scans files it hasn't seen.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+namespace PluginScanProtocol
+{
+    /** Passed on the worker's command line, so a plain launch isn't mistaken for one. */
+    static constexpr const char* commandLineID = "unixmatrix-plugin-scan";
+
+    // Coordinator -> worker:  <SCAN format="VST3" identifier="/path/to/plugin.vst3"/>
+    // Worker -> coordinator:  <RESULT> <PLUGIN .../> ... </RESULT>
+
+    inline juce::MemoryBlock toMessage (const juce::XmlElement& xml)
+    {
+        const auto text = xml.toString (juce::XmlElement::TextFormat().singleLine().withoutHeader());
+        return { text.toRawUTF8(), text.getNumBytesAsUTF8() };
+    }
+}
+
+//==============================================================================
+/** The child process side. Main.cpp creates one when started with the
+    worker command line; the process then shows no window and quits when the
+    coordinator goes away.
+*/
+class PluginScanWorker  : private juce::ChildProcessWorker,
+                          private juce::AsyncUpdater
+{
+public:
+    /** Returns nullptr unless this process was launched as a scan worker. */
+    static std::unique_ptr<PluginScanWorker> createIfRequested (const juce::String& commandLine)
+    {
+        auto worker = std::unique_ptr<PluginScanWorker> (new PluginScanWorker());
+
+        if (! worker->initialiseFromCommandLine (commandLine, PluginScanProtocol::commandLineID, 10000))
+            return {};
+
+        return worker;
+    }
+
+    ~PluginScanWorker() override
+    {
+        cancelPendingUpdate();
+    }
+
+private:
+    PluginScanWorker()
+    {
+        formatManager.addDefaultFormats();
+    }
+
+    void handleMessageFromCoordinator (const juce::MemoryBlock& message) override
+    {
+        {
+            const juce::ScopedLock sl (requestLock);
+            pendingRequest = juce::parseXML (message.toString());
+        }
+
+        // Some formats must be loaded on the message thread
+        triggerAsyncUpdate();
+    }
+
+    void handleConnectionLost() override
+    {
+        juce::MessageManager::callAsync ([] { juce::JUCEApplicationBase::quit(); });
+    }
+
+    void handleAsyncUpdate() override
+    {
+        std::unique_ptr<juce::XmlElement> request;
+
+        {
+            const juce::ScopedLock sl (requestLock);
+            request = std::move (pendingRequest);
+        }
+
+        if (request == nullptr || ! request->hasTagName ("SCAN"))
+            return;
+
+        juce::XmlElement reply ("RESULT");
+        const auto formatName = request->getStringAttribute ("format");
+
+        for (int i = 0; i < formatManager.getNumFormats(); ++i)
+        {
+            if (auto* format = formatManager.getFormat (i); format->getName() == formatName)
+            {
+                juce::OwnedArray<juce::PluginDescription> found;
+                format->findAllTypesForFile (found, request->getStringAttribute ("identifier"));
+
+                for (auto* description : found)
+                    reply.addChildElement (description->createXml().release());
+            }
+        }
+
+        sendMessageToCoordinator (PluginScanProtocol::toMessage (reply));
+    }
+
+    juce::AudioPluginFormatManager formatManager;
+    juce::CriticalSection requestLock;
+    std::unique_ptr<juce::XmlElement> pendingRequest;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginScanWorker)
+};
+
+//==============================================================================
+/** KnownPluginList hook that sends each file to a worker process instead of
+    loading it here. Called on the scanning thread.
+*/
+class OutOfProcessScanner  : public juce::KnownPluginList::CustomScanner
+{
+public:
+    /** shouldCancel is polled while a file is being scanned, e.g. the scanning
+        thread's threadShouldExit().
+    */
+    explicit OutOfProcessScanner (std::function<bool()> shouldCancelToUse)
+        : shouldCancel (std::move (shouldCancelToUse))
+    {
+    }
+
+    bool findPluginTypesFor (juce::AudioPluginFormat& format,
+                             juce::OwnedArray<juce::PluginDescription>& result,
+                             const juce::String& fileOrIdentifier) override
+    {
+        if (worker == nullptr)
+        {
+            worker = std::make_unique<Worker>();
+
+            if (! worker->launch())
+            {
+                juce::Logger::writeToLog ("[plugins] can't start the scan worker");
+                worker.reset();
+                return false;
+            }
+        }
+
+        juce::XmlElement request ("SCAN");
+        request.setAttribute ("format", format.getName());
+        request.setAttribute ("identifier", fileOrIdentifier);
+
+        auto reply = worker->scan (request, [this] { return shouldCancel(); });
+
+        if (reply == nullptr && shouldCancel())
+        {
+            // Not the file's fault: false would blacklist it. With no types
+            // listed for it, the next scan tries it again.
+            worker.reset();
+            return true;
+        }
+
+        if (reply == nullptr)
+        {
+            // Crashed or hung: this file is reported as failed, the next one gets a new worker
+            juce::Logger::writeToLog ("[plugins] scan worker lost on " + fileOrIdentifier);
+            worker.reset();
+            return false;
+        }
+
+        for (auto* child : reply->getChildIterator())
+        {
+            auto description = std::make_unique<juce::PluginDescription>();
+
+            if (description->loadFromXml (*child))
+                result.add (description.release());
+        }
+
+        return true;
+    }
+
+    void scanFinished() override
+    {
+        worker.reset();
+    }
+
+private:
+    class Worker  : private juce::ChildProcessCoordinator
+    {
+    public:
+        /** Longest a single file may take before its worker is killed. */
+        static constexpr juce::uint32 scanTimeoutMs = 30000;
+
+        ~Worker() override
+        {
+            killWorkerProcess();
+        }
+
+        bool launch()
+        {
+            // Pings every few seconds: a worker that crashes or exits counts as
+            // lost. The pings come from the worker's own thread, so a plug-in
+            // hanging its message thread is caught by scan()'s deadline instead.
+            return launchWorkerProcess (juce::File::getSpecialLocation (juce::File::currentExecutableFile),
+                                        PluginScanProtocol::commandLineID, 10000);
+        }
+
+        /** Returns nullptr if the worker died, hung, or the scan was cancelled. */
+        std::unique_ptr<juce::XmlElement> scan (const juce::XmlElement& request, std::function<bool()> shouldCancel)
+        {
+            replied.reset();
+
+            {
+                const juce::ScopedLock sl (replyLock);
+                reply.reset();
+            }
+
+            if (! sendMessageToWorker (PluginScanProtocol::toMessage (request)))
+                return {};
+
+            const auto deadline = juce::Time::getMillisecondCounter() + scanTimeoutMs;
+
+            while (! replied.wait (100))
+            {
+                if (shouldCancel())
+                    return {};
+
+                if (juce::Time::getMillisecondCounter() > deadline)
+                {
+                    killWorkerProcess();
+                    return {};
+                }
+            }
+
+            const juce::ScopedLock sl (replyLock);
+            return std::move (reply);
+        }
+
+    private:
+        void handleMessageFromWorker (const juce::MemoryBlock& message) override
+        {
+            {
+                const juce::ScopedLock sl (replyLock);
+                reply = juce::parseXML (message.toString());
+            }
+
+            replied.signal();
+        }
+
+        void handleConnectionLost() override
+        {
+            replied.signal(); // with no reply
+        }
+
+        juce::WaitableEvent replied;
+        juce::CriticalSection replyLock;
+        std::unique_ptr<juce::XmlElement> reply;
+    };
+
+    std::function<bool()> shouldCancel;
+    std::unique_ptr<Worker> worker;
+};
+
+//==============================================================================
+/** The app's list of effect plug-ins: loaded from the cache at once, then
+    refreshed by a background scan.
+*/
+class PluginCatalogue  : private juce::Thread
+{
+public:
+    PluginCatalogue()
+        : juce::Thread ("Plug-in scan")
+    {
+        formatManager.addDefaultFormats();
+        // Quitting mid-file must not wait out the worker's scan timeout
+        knownPlugins.setCustomScanner (std::make_unique<OutOfProcessScanner> ([this] { return threadShouldExit(); }));
+
+        if (const auto cached = juce::parseXML (getCacheFile()))
+            knownPlugins.recreateFromXml (*cached);
+    }
+
+    ~PluginCatalogue() override
+    {
+        stopThread (5000);
+    }
+
+    /** Any thread; does nothing if a scan is already running. */
+    void startScan()                                    { startThread (juce::Thread::Priority::low); }
+    bool isScanning() const                             { return isThreadRunning(); }
+
+    juce::AudioPluginFormatManager& getFormatManager() noexcept     { return formatManager; }
+
+    /** A ChangeBroadcaster too: it notifies as types are found. */
+    juce::KnownPluginList& getKnownPlugins() noexcept               { return knownPlugins; }
+
+private:
+    void run() override
+    {
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        const auto deadMansPedal = getCacheFile().getSiblingFile ("plugin-scan-in-progress.txt");
+
+        for (int i = 0; i < formatManager.getNumFormats() && ! threadShouldExit(); ++i)
+        {
+            auto* format = formatManager.getFormat (i);
+
+            if (! format->canScanForPlugins())
+                continue;
+
+            juce::PluginDirectoryScanner scanner (knownPlugins, *format, format->getDefaultLocationsToSearch(),
+                                                  true, deadMansPedal, true);
+            juce::String pluginName;
+
+            while (! threadShouldExit() && scanner.scanNextFile (true, pluginName))
+            {
+            }
+
+            for (const auto& failed : scanner.getFailedFiles())
+                juce::Logger::writeToLog ("[plugins] failed: " + failed);
+        }
+
+        if (threadShouldExit())
+            return;
+
+        if (const auto xml = knownPlugins.createXml())
+        {
+            getCacheFile().getParentDirectory().createDirectory();
+            xml->writeTo (getCacheFile());
+        }
+
+        juce::Logger::writeToLog (juce::String::formatted ("[plugins] %d type(s) known, scan took %.1f s",
+                                                           knownPlugins.getNumTypes(),
+                                                           (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0));
+    }
+
+    static juce::File getCacheFile()
+    {
+        return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                 .getChildFile (juce::JUCEApplicationBase::getInstance() != nullptr
+                                    ? juce::JUCEApplicationBase::getInstance()->getApplicationName()
+                                    : juce::String ("PlayingSoundFilesTutorial"))
+                 .getChildFile ("plugins.xml");
+    }
+
+    juce::AudioPluginFormatManager formatManager;
+    juce::KnownPluginList knownPlugins;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginCatalogue)
+};
@@ -0,0 +1,402 @@
+/*
+  ==============================================================================
+
+   RemoteControl.h
+
+   Local control surface over a named pipe (juce::InterprocessConnection):
+   no network involved. A client can load a file, play, pause, stop, seek,
+   set the gain and subscribe to meter frames.
+
+   Every message is one InterprocessConnection packet: an opcode byte then a
+   little-endian payload. Meter frames are built on a dedicated thread from
+   the engine's published atomics, at up to 1 kHz; the audio thread only
+   does what it does for the UI meters anyway.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PlayerEngine.h"
+
+namespace RemoteProtocol
+{
+    inline const char* const pipeName = "UnixMatrixPlayer";
+
+    enum class Opcode : juce::uint8
+    {
+        // client -> player
+        load = 1,           // UTF-8 path
+        play,
+        pause,
+        stop,
+        seek,               // float64 seconds
+        setGain,            // float32 linear gain
+        subscribeMeters,    // uint16 frames per second, 0 = off
+
+        // player -> client
+        state = 64,         // uint8 PlayerEngine::State
+        meterFrame,         // see MeterFrame
+        error               // UTF-8 message
+    };
+
+    constexpr int maxMeterRate = 1000;
+
+    /** uint8 numChannels, uint32 sequence, float64 position (s), float32 level,
+        then numChannels float32 peaks.
+    */
+    struct MeterFrame
+    {
+        juce::uint32 sequence = 0;
+        double position = 0.0;
+        float level = 0.0f;
+        int numChannels = 0;
+        std::array<float, ChannelRouter::maxChannels> peaks {};
+
+        void writeTo (juce::MemoryOutputStream& out) const
+        {
+            out.writeByte ((char) Opcode::meterFrame);
+            out.writeByte ((char) numChannels);
+            out.writeInt ((int) sequence);
+            out.writeDouble (position);
+            out.writeFloat (level);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                out.writeFloat (peaks[(size_t) ch]);
+        }
+
+        /** in is positioned just after the opcode. */
+        static MeterFrame readFrom (juce::MemoryInputStream& in)
+        {
+            MeterFrame frame;
+            frame.numChannels = juce::jmin ((int) (juce::uint8) in.readByte(), ChannelRouter::maxChannels);
+            frame.sequence    = (juce::uint32) in.readInt();
+            frame.position    = in.readDouble();
+            frame.level       = in.readFloat();
+
+            for (int ch = 0; ch < frame.numChannels; ++ch)
+                frame.peaks[(size_t) ch] = in.readFloat();
+
+            return frame;
+        }
+    };
+
+    inline juce::MemoryBlock makeMessage (Opcode opcode, std::function<void (juce::MemoryOutputStream&)> writePayload = {})
+    {
+        juce::MemoryOutputStream out;
+        out.writeByte ((char) opcode);
+
+        if (writePayload != nullptr)
+            writePayload (out);
+
+        return out.getMemoryBlock();
+    }
+}
+
+//==============================================================================
+/** The player's end. Lives on the message thread; commands arrive there and
+    are handed to the same callbacks the buttons use.
+*/
+class RemoteControlServer  : private juce::InterprocessConnection,
+                             private PlayerEngine::Listener,
+                             private juce::AsyncUpdater,
+                             private juce::Thread
+{
+public:
+    /** Hooks into the UI, so remote actions look exactly like clicks. */
+    std::function<bool (const juce::File&)> onLoad;
+    std::function<void()> onPlay, onPause, onStop;
+    std::function<void (double)> onSeek;
+    std::function<void (float)> onGain;
+
+    explicit RemoteControlServer (PlayerEngine& engineToUse)
+        : juce::InterprocessConnection (true),
+          juce::Thread ("Remote meters"),
+          engine (engineToUse)
+    {
+        engine.addListener (this);
+    }
+
+    /** Opens the pipe. Not before the callbacks can run, e.g. once the
+        formats onLoad needs are registered.
+    */
+    void start()
+    {
+        triggerAsyncUpdate();
+        startThread (juce::Thread::Priority::low);
+    }
+
+    ~RemoteControlServer() override
+    {
+        stopThread (pipeTimeoutMs * 2);
+        cancelPendingUpdate();
+        engine.removeListener (this);
+        disconnect();
+    }
+
+private:
+    using Opcode = RemoteProtocol::Opcode;
+
+    /** Longest a read or write on the pipe may block. A client that stops
+        reading for that long is disconnected.
+    */
+    static constexpr int pipeTimeoutMs = 500;
+
+    // (Re)opens the pipe; a pipe takes one client at a time
+    void handleAsyncUpdate() override
+    {
+        if (! createPipe (RemoteProtocol::pipeName, pipeTimeoutMs, false))
+            juce::Logger::writeToLog ("[remote] can't create pipe " + juce::String (RemoteProtocol::pipeName));
+    }
+
+    void connectionMade() override      {}
+
+    void connectionLost() override
+    {
+        meterRate = 0;
+        triggerAsyncUpdate();
+    }
+
+    void messageReceived (const juce::MemoryBlock& message) override
+    {
+        juce::MemoryInputStream in (message, false);
+
+        switch ((Opcode) (juce::uint8) in.readByte())
+        {
+            case Opcode::load:
+            {
+                const juce::File file (in.readEntireStreamAsString());
+
+                if (onLoad == nullptr || ! onLoad (file))
+                    sendError ("Can't load " + file.getFullPathName());
+
+                break;
+            }
+
+            case Opcode::play:              if (onPlay  != nullptr) onPlay();   break;
+            case Opcode::pause:             if (onPause != nullptr) onPause();  break;
+            case Opcode::stop:              if (onStop  != nullptr) onStop();   break;
+            case Opcode::seek:              if (onSeek  != nullptr) onSeek (in.readDouble()); break;
+            case Opcode::setGain:           if (onGain  != nullptr) onGain (in.readFloat());  break;
+
+            case Opcode::subscribeMeters:
+                meterRate = juce::jlimit (0, RemoteProtocol::maxMeterRate, (int) (juce::uint16) in.readShort());
+                notify();
+                break;
+
+            case Opcode::state:
+            case Opcode::meterFrame:
+            case Opcode::error:
+            default:
+                sendError ("Unknown opcode");
+                break;
+        }
+    }
+
+    void playerStateChanged (PlayerEngine::State newState) override
+    {
+        if (isConnected())
+            sendMessage (RemoteProtocol::makeMessage (Opcode::state, [newState] (auto& out) { out.writeByte ((char) newState); }));
+    }
+
+    void sendError (const juce::String& text)
+    {
+        sendMessage (RemoteProtocol::makeMessage (Opcode::error, [&text] (auto& out) { out << text; }));
+    }
+
+    //==============================================================================
+    // Meter thread: reads what the audio thread already publishes for the UI
+    void run() override
+    {
+        RemoteProtocol::MeterFrame frame;
+        auto nextFrameMs = juce::Time::getMillisecondCounterHiRes();
+
+        while (! threadShouldExit())
+        {
+            const auto rate = meterRate.load();
+
+            if (rate == 0 || ! isConnected())
+            {
+                wait (100);
+                nextFrameMs = juce::Time::getMillisecondCounterHiRes();
+                continue;
+            }
+
+            frame.numChannels = engine.getNumOutputChannels();
+            frame.position = engine.getPublishedPosition();
+            frame.level = engine.getLevel();
+
+            for (int ch = 0; ch < frame.numChannels; ++ch)
+                frame.peaks[(size_t) ch] = engine.takeChannelPeak (ch, PlayerEngine::remoteTap);
+
+            juce::MemoryOutputStream out (256);
+            frame.writeTo (out);
+
+            // A timed-out write may have left half a frame in the pipe: the
+            // stream can't be trusted after it, so drop the client
+            if (! sendMessage (out.getMemoryBlock()))
+            {
+                juce::Logger::writeToLog ("[remote] the client stopped reading meter frames: disconnected");
+                meterRate = 0;
+                disconnect();
+                continue;
+            }
+
+            ++frame.sequence;
+
+            // Absolute schedule, so the rate doesn't drift with send time
+            nextFrameMs += 1000.0 / rate;
+            const auto waitMs = nextFrameMs - juce::Time::getMillisecondCounterHiRes();
+
+            if (waitMs >= 1.0)
+                wait ((int) waitMs);
+            else if (waitMs < -100.0)
+                nextFrameMs = juce::Time::getMillisecondCounterHiRes(); // the client stalled; don't burst
+        }
+    }
+
+    PlayerEngine& engine;
+    std::atomic<int> meterRate { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RemoteControlServer)
+};
+
+//==============================================================================
+/** The automation end, also used by the app's --remote command-line mode. */
+class RemoteControlClient  : public juce::InterprocessConnection
+{
+public:
+    std::function<void (const RemoteProtocol::MeterFrame&)> onMeterFrame;
+    std::function<void (PlayerEngine::State)> onStateChanged;
+    std::function<void (const juce::String&)> onError;
+
+    /** Callbacks arrive on the connection's own thread. */
+    RemoteControlClient()  : juce::InterprocessConnection (false) {}
+
+    ~RemoteControlClient() override
+    {
+        disconnect();
+    }
+
+    bool connect (int timeoutMs = 1000)          { return connectToPipe (RemoteProtocol::pipeName, timeoutMs); }
+
+    bool load (const juce::File& file)          { return send (Opcode::load, [&file] (auto& out) { out << file.getFullPathName(); }); }
+    bool play()                                 { return send (Opcode::play); }
+    bool pause()                                { return send (Opcode::pause); }
+    bool stop()                                 { return send (Opcode::stop); }
+    bool seek (double seconds)                  { return send (Opcode::seek, [seconds] (auto& out) { out.writeDouble (seconds); }); }
+    bool setGain (float gain)                   { return send (Opcode::setGain, [gain] (auto& out) { out.writeFloat (gain); }); }
+
+    bool subscribeMeters (int framesPerSecond)
+    {
+        return send (Opcode::subscribeMeters, [framesPerSecond] (auto& out)
+        {
+            out.writeShort ((short) juce::jlimit (0, RemoteProtocol::maxMeterRate, framesPerSecond));
+        });
+    }
+
+    //==============================================================================
+    /** --remote play | pause | stop | load <file> | seek <s> | gain <g> | meters <fps> <seconds>
+        Returns the process exit code.
+    */
+    static int runCommandLine (const juce::StringArray& args)
+    {
+        RemoteControlClient client;
+
+        if (! client.connect())
+        {
+            juce::Logger::writeToLog ("[remote] no player is listening on " + juce::String (RemoteProtocol::pipeName));
+            return 1;
+        }
+
+        const auto command = args[0];
+        const auto argument = args[1].unquoted();
+        bool sent = false;
+
+        if (command == "play")          sent = client.play();
+        else if (command == "pause")    sent = client.pause();
+        else if (command == "stop")     sent = client.stop();
+        else if (command == "load")     sent = client.load (juce::File::getCurrentWorkingDirectory().getChildFile (argument));
+        else if (command == "seek")     sent = client.seek (argument.getDoubleValue());
+        else if (command == "gain")     sent = client.setGain (argument.getFloatValue());
+        else if (command == "meters")   return client.streamMeters (argument.getIntValue(), args[2].getDoubleValue());
+
+        if (! sent)
+        {
+            juce::Logger::writeToLog ("[remote] usage: --remote play|pause|stop|load <file>|seek <s>|gain <g>|meters <fps> <seconds>");
+            return 1;
+        }
+
+        juce::Thread::sleep (100); // give the player a chance to report an error
+        return 0;
+    }
+
+private:
+    using Opcode = RemoteProtocol::Opcode;
+
+    bool send (Opcode opcode, std::function<void (juce::MemoryOutputStream&)> payload = {})
+    {
+        return sendMessage (RemoteProtocol::makeMessage (opcode, std::move (payload)));
+    }
+
+    int streamMeters (int framesPerSecond, double seconds)
+    {
+        std::atomic<int> received { 0 };
+        std::atomic<juce::uint32> lastSequence { 0 };
+
+        onMeterFrame = [&] (const RemoteProtocol::MeterFrame& frame)
+        {
+            ++received;
+            lastSequence = frame.sequence;
+        };
+
+        subscribeMeters (framesPerSecond);
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        juce::Thread::sleep (juce::roundToInt (juce::jmax (0.1, seconds) * 1000.0));
+        subscribeMeters (0);
+        disconnect(); // stops the callback thread before the locals go away
+
+        const auto elapsed = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+        juce::Logger::writeToLog (juce::String::formatted ("[remote] %d meter frames in %.2f s (%.0f per second), last sequence %u",
+                                                           received.load(), elapsed, received.load() / elapsed,
+                                                           (unsigned int) lastSequence.load()));
+        return received > 0 ? 0 : 1;
+    }
+
+    void connectionMade() override      {}
+    void connectionLost() override      {}
+
+    void messageReceived (const juce::MemoryBlock& message) override
+    {
+        juce::MemoryInputStream in (message, false);
+
+        switch ((Opcode) (juce::uint8) in.readByte())
+        {
+            case Opcode::meterFrame:
+                if (onMeterFrame != nullptr)
+                    onMeterFrame (RemoteProtocol::MeterFrame::readFrom (in));
+                break;
+
+            case Opcode::state:
+                if (onStateChanged != nullptr)
+                    onStateChanged ((PlayerEngine::State) in.readByte());
+                break;
+
+            case Opcode::error:
+            {
+                const auto text = in.readEntireStreamAsString();
+                juce::Logger::writeToLog ("[remote] " + text);
+
+                if (onError != nullptr)
+                    onError (text);
+
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RemoteControlClient)
+};
@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+   Sampler.h
+
+   Plays one in-memory sample polyphonically from MIDI notes, repitched
+   across the keyboard from its root note.
+
+   The voice pool is allocated once. Note-ons arrive from any thread through
+   a lock-free queue and are handled at the start of the next block, so the
+   audio thread never allocates. When the pool is full the oldest voice is
+   faded out over a few milliseconds and its slot is reused. Pitch shifting
+   uses 4-point Hermite interpolation with dsp::SIMDRegister lanes, several
+   output samples per vector.
+
+   Start the app with --benchmark-sampler to measure how many voices one
+   core can sustain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LockFreeExchange.h"
+
+class Sampler
+{
+public:
+    static constexpr int defaultNumVoices = 64;
+    static constexpr double maxSampleSeconds = 60.0;
+
+    explicit Sampler (int numVoicesToAllocate = defaultNumVoices)
+        : voices ((size_t) juce::jmax (1, numVoicesToAllocate))
+    {
+        envelopeSettings.write (envelopeParameters);
+    }
+
+    //==============================================================================
+    /** Message thread. Reads up to maxSampleSeconds into memory; the old
+        sample's voices are cut. rootNote is the MIDI note that plays the
+        sample at its original pitch.
+    */
+    bool loadSample (juce::AudioFormatReader& reader, int rootNote = 60)
+    {
+        const auto length = (int) juce::jmin (reader.lengthInSamples, (juce::int64) (reader.sampleRate * maxSampleSeconds));
+
+        if (length <= 0 || reader.sampleRate <= 0.0)
+            return false;
+
+        auto newSample = std::make_unique<Sample>();
+        newSample->sampleRate = reader.sampleRate;
+        newSample->rootNote = rootNote;
+        newSample->length = length;
+
+        // One guard sample before and two after, so the interpolator never
+        // has to check the bounds
+        newSample->data.setSize ((int) juce::jmin (reader.numChannels, (unsigned int) maxChannels), length + 3);
+        newSample->data.clear();
+        reader.read (&newSample->data, 1, length, 0, true, true);
+
+        {
+            const juce::ScopedLock sl (sampleLock); // render() only try-locks it
+            sample.swap (newSample);
+            resetVoices();
+        }
+
+        return true;
+    }
+
+    void clearSample()
+    {
+        const juce::ScopedLock sl (sampleLock);
+        sample.reset();
+        resetVoices();
+    }
+
+    int getNumChannels() const noexcept                 { return sample != nullptr ? sample->data.getNumChannels() : 0; }
+
+    /** Message thread. */
+    void setEnvelope (const juce::ADSR::Parameters& newParameters)
+    {
+        envelopeParameters = newParameters;
+        envelopeSettings.write (newParameters);
+    }
+
+    const juce::ADSR::Parameters& getEnvelope() const noexcept   { return envelopeParameters; }
+
+    //==============================================================================
+    // Any thread (MIDI input, message thread); queued for the next block
+    void noteOn (int note, float velocity) noexcept     { post ({ NoteEvent::Type::noteOn, note, velocity }); }
+    void noteOff (int note) noexcept                    { post ({ NoteEvent::Type::noteOff, note, 0.0f }); }
+    void allNotesOff() noexcept                         { post ({ NoteEvent::Type::allNotesOff, -1, 0.0f }); }
+
+    int getNumActiveVoices() const noexcept             { return numActiveVoices.load (std::memory_order_relaxed); }
+    int getNumVoices() const noexcept                   { return (int) voices.size(); }
+
+    //==============================================================================
+    void prepare (double newSampleRate, int samplesPerBlockExpected)
+    {
+        sampleRate = newSampleRate;
+        stealFadeSamples = juce::jmax (1, juce::roundToInt (newSampleRate * stealFadeSeconds));
+        callbackLoad.reset (newSampleRate, samplesPerBlockExpected);
+
+        const juce::ScopedLock sl (sampleLock);
+
+        for (auto& v : voices)
+            v.envelope.setSampleRate (newSampleRate);
+
+        resetVoices();
+    }
+
+    /** Audio thread. Adds the voices into the first getNumChannels() channels
+        of the buffer; silence if the sample is being swapped.
+    */
+    void render (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        const juce::AudioProcessLoadMeasurer::ScopedTimer timer (callbackLoad, numSamples);
+        const juce::ScopedTryLock stl (sampleLock);
+
+        if (! stl.isLocked() || sample == nullptr)
+            return;
+
+        if (auto* newEnvelope = envelopeSettings.readIfNew())
+            for (auto& v : voices)
+                v.envelope.setParameters (*newEnvelope);
+
+        runPendingNoteEvents();
+
+        int numActive = 0;
+
+        for (auto& v : voices)
+        {
+            if (v.isActive())
+            {
+                renderVoice (v, *sample, buffer, startSample, numSamples);
+                numActive += v.isActive() ? 1 : 0;
+            }
+        }
+
+        numActiveVoices.store (numActive, std::memory_order_relaxed);
+    }
+
+    /** Live CPU cost, logged next to PlayerEngine::logProcessingLoad(). */
+    void logProcessingLoad() const
+    {
+        const auto load = callbackLoad.getLoadAsProportion();
+        const auto numActive = getNumActiveVoices();
+        const auto perVoice = numActive > 0 ? load / numActive : 0.0;
+
+        juce::Logger::writeToLog (juce::String::formatted ("[sampler] %d voice(s): %.2f %% of the block period (~%d voices per core)",
+                                                           numActive, load * 100.0, perVoice > 0.0 ? (int) (1.0 / perVoice) : 0));
+    }
+
+    //==============================================================================
+    /** Renders blocks of 128 samples at 48 kHz with more and more voices held
+        across the keyboard, and logs the cost until a block takes longer than
+        its own duration. Lines look like:
+            [sampler] 256 voices   0.91 ms per 2.67 ms block  (34.1 %)  ~750 voices per core
+    */
+    static void runBenchmark (juce::AudioFormatReader& reader)
+    {
+        constexpr double benchmarkRate = 48000.0;
+        constexpr int blockSize = 128, numBlocks = 2000, maxBenchmarkVoices = 4096;
+        const auto blockMs = blockSize * 1000.0 / benchmarkRate;
+
+        Sampler sampler (maxBenchmarkVoices);
+        sampler.prepare (benchmarkRate, blockSize);
+
+        if (! sampler.loadSample (reader))
+        {
+            juce::Logger::writeToLog ("[sampler] benchmark: can't read the sample");
+            return;
+        }
+
+        juce::AudioBuffer<float> buffer (sampler.getNumChannels(), blockSize);
+
+        for (int numVoices = 16; numVoices <= maxBenchmarkVoices; numVoices *= 2)
+        {
+            double totalSeconds = 0.0;
+            int nextNote = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                // Keep the pool topped up; notes cycle over five octaves
+                for (int i = sampler.getNumActiveVoices(), queued = 0; i < numVoices && queued < queueSize - 1; ++i, ++queued)
+                    sampler.noteOn (36 + nextNote++ % 60, 0.8f);
+
+                buffer.clear();
+                const auto start = juce::Time::getHighResolutionTicks();
+                sampler.render (buffer, 0, blockSize);
+                totalSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+            }
+
+            const auto meanMs = totalSeconds * 1000.0 / numBlocks;
+
+            juce::Logger::writeToLog (juce::String::formatted ("[sampler] %4d voices  %6.3f ms per %.2f ms block  (%5.1f %%)  ~%d voices per core",
+                                                               numVoices, meanMs, blockMs, meanMs * 100.0 / blockMs,
+                                                               meanMs > 0.0 ? (int) (numVoices * blockMs / meanMs) : 0));
+
+            sampler.resetVoices(); // single-threaded here, no need to go through the queue
+
+            if (meanMs > blockMs)
+                break;
+        }
+    }
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int lanes = (int) Vec::SIMDNumElements;
+    static constexpr int maxChannels = 8;
+    static constexpr int queueSize = 256;
+    static constexpr double stealFadeSeconds = 0.005;
+
+    struct Sample
+    {
+        juce::AudioBuffer<float> data; // guard sample first, see loadSample()
+        double sampleRate = 44100.0;
+        int rootNote = 60;
+        int length = 0;
+    };
+
+    struct Voice
+    {
+        int note = -1;                  // -1 = free
+        float gain = 0.0f;
+        double position = 0.0, increment = 1.0;
+        juce::ADSR envelope;
+        int fadeLeft = 0;               // > 0 while being stolen
+        juce::uint32 age = 0;           // note-on order, for stealing
+
+        bool isActive() const noexcept          { return note >= 0; }
+        bool isBeingStolen() const noexcept     { return fadeLeft > 0; }
+    };
+
+    struct NoteEvent
+    {
+        enum class Type { noteOn, noteOff, allNotesOff };
+
+        Type type = Type::allNotesOff;
+        int note = -1;
+        float velocity = 0.0f;
+    };
+
+    //==============================================================================
+    void post (const NoteEvent& event) noexcept
+    {
+        const juce::SpinLock::ScopedLockType sl (eventWriterLock); // several MIDI inputs may write
+
+        int start1, size1, start2, size2;
+        noteEvents.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            events[(size_t) start1] = event;
+            noteEvents.finishedWrite (1);
+        }
+    }
+
+    void runPendingNoteEvents() noexcept
+    {
+        const auto numReady = noteEvents.getNumReady();
+
+        if (numReady == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        noteEvents.prepareToRead (numReady, start1, size1, start2, size2);
+
+        for (int i = 0; i < size1 + size2; ++i)
+        {
+            const auto& event = events[(size_t) (i < size1 ? start1 + i : start2 + i - size1)];
+
+            switch (event.type)
+            {
+                case NoteEvent::Type::noteOn:       startVoice (event.note, event.velocity); break;
+                case NoteEvent::Type::noteOff:      releaseVoices (event.note); break;
+                case NoteEvent::Type::allNotesOff:  releaseVoices (-1); break;
+            }
+        }
+
+        noteEvents.finishedRead (size1 + size2);
+    }
+
+    void startVoice (int note, float velocity) noexcept
+    {
+        auto* voice = findFreeVoice();
+
+        if (voice == nullptr)
+        {
+            voice = stealVoice();
+
+            // Every slot is already fading out: cut the one closest to silence
+            if (voice == nullptr)
+                voice = &*std::min_element (voices.begin(), voices.end(),
+                                            [] (const Voice& a, const Voice& b) { return a.fadeLeft < b.fadeLeft; });
+        }
+
+        voice->note = note;
+        voice->gain = juce::jlimit (0.0f, 1.0f, velocity);
+        voice->position = 0.0;
+        voice->increment = sample->sampleRate / sampleRate * std::pow (2.0, (note - sample->rootNote) / 12.0);
+        voice->fadeLeft = 0;
+        voice->age = nextAge++;
+        voice->envelope.reset();
+        voice->envelope.noteOn();
+
+        // Keep a free slot for the next note-on: the oldest voice starts fading now
+        if (findFreeVoice() == nullptr)
+            stealVoice();
+    }
+
+    Voice* findFreeVoice() noexcept
+    {
+        for (auto& v : voices)
+            if (! v.isActive())
+                return &v;
+
+        return nullptr;
+    }
+
+    /** Starts fading out the oldest voice that isn't already fading, and
+        returns it (or nullptr if they all are).
+    */
+    Voice* stealVoice() noexcept
+    {
+        Voice* oldest = nullptr;
+
+        for (auto& v : voices)
+            if (v.isActive() && ! v.isBeingStolen() && (oldest == nullptr || v.age - oldest->age > 0x80000000u))
+                oldest = &v;
+
+        if (oldest != nullptr)
+            oldest->fadeLeft = stealFadeSamples;
+
+        return oldest;
+    }
+
+    void releaseVoices (int note) noexcept
+    {
+        for (auto& v : voices)
+            if (v.isActive() && (note < 0 || v.note == note))
+                v.envelope.noteOff();
+    }
+
+    void resetVoices() noexcept
+    {
+        for (auto& v : voices)
+        {
+            v.note = -1;
+            v.fadeLeft = 0;
+            v.envelope.reset();
+        }
+
+        numActiveVoices.store (0, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /** Lanes output samples at a time: the positions and the envelope are
+        stepped in scalar code, then the four Hermite taps are gathered and
+        the polynomial is evaluated on whole vectors.
+    */
+    void renderVoice (Voice& v, const Sample& s, juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        const auto numChannels = juce::jmin (buffer.getNumChannels(), s.data.getNumChannels());
+
+        alignas (Vec::SIMDRegisterSize) float frac[lanes], amp[lanes], out[lanes];
+        alignas (Vec::SIMDRegisterSize) float xm1[lanes], x0[lanes], x1[lanes], x2[lanes];
+        int index[lanes];
+
+        const auto half = Vec::expand (0.5f), oneAndHalf = Vec::expand (1.5f),
+                   two = Vec::expand (2.0f), twoAndHalf = Vec::expand (2.5f);
+
+        for (int pos = 0; pos < numSamples && v.isActive(); pos += lanes)
+        {
+            int num = juce::jmin (lanes, numSamples - pos);
+
+            for (int i = 0; i < num; ++i)
+            {
+                if (v.position >= (double) s.length || ! v.envelope.isActive() || (v.isBeingStolen() && --v.fadeLeft == 0))
+                {
+                    v.note = -1;
+                    v.fadeLeft = 0;
+                    num = i;
+                    break;
+                }
+
+                index[i] = (int) v.position;
+                frac[i] = (float) (v.position - index[i]);
+                amp[i] = v.gain * v.envelope.getNextSample()
+                           * (v.isBeingStolen() ? (float) v.fadeLeft / (float) stealFadeSamples : 1.0f);
+                v.position += v.increment;
+            }
+
+            for (int i = num; i < lanes; ++i)
+            {
+                index[i] = 0;
+                frac[i] = amp[i] = 0.0f;
+            }
+
+            const auto t = Vec::fromRawArray (frac);
+            const auto a = Vec::fromRawArray (amp);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const auto* data = s.data.getReadPointer (ch); // data[index] is the sample before index
+
+                for (int i = 0; i < lanes; ++i)
+                {
+                    xm1[i] = data[index[i]];
+                    x0[i]  = data[index[i] + 1];
+                    x1[i]  = data[index[i] + 2];
+                    x2[i]  = data[index[i] + 3];
+                }
+
+                const auto vm1 = Vec::fromRawArray (xm1), v0 = Vec::fromRawArray (x0),
+                           v1  = Vec::fromRawArray (x1),  v2 = Vec::fromRawArray (x2);
+
+                const auto c1 = half * (v1 - vm1);
+                const auto c2 = vm1 - twoAndHalf * v0 + two * v1 - half * v2;
+                const auto c3 = half * (v2 - vm1) + oneAndHalf * (v0 - v1);
+
+                (a * (((c3 * t + c2) * t + c1) * t + v0)).copyToRawArray (out);
+                juce::FloatVectorOperations::add (buffer.getWritePointer (ch, startSample + pos), out, num);
+            }
+        }
+    }
+
+    //==============================================================================
+    std::vector<Voice> voices;
+    std::unique_ptr<Sample> sample;
+    juce::CriticalSection sampleLock; // guards swapping the sample; held by render()
+
+    double sampleRate = 44100.0;
+    int stealFadeSamples = 1;
+    juce::uint32 nextAge = 0;
+
+    juce::AbstractFifo noteEvents { queueSize };
+    std::array<NoteEvent, queueSize> events {};
+    juce::SpinLock eventWriterLock;
+
+    juce::ADSR::Parameters envelopeParameters { 0.005f, 0.1f, 0.8f, 0.3f };
+    TripleBuffer<juce::ADSR::Parameters> envelopeSettings;
+
+    std::atomic<int> numActiveVoices { 0 };
+    juce::AudioProcessLoadMeasurer callbackLoad;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sampler)
+};
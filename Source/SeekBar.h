@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+   SeekBar.h
+
+   Position bar plus h:mm:ss.mmm readout that can be dragged to seek.
+
+   update() is called every UI frame. It formats into a stack buffer and
+   compares it with what is on screen, and repaints only when the text, the
+   fill width or the status changes. Seeks are handed to onSeek, which the
+   player routes through its transport command queue.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class SeekBar  : public juce::Component
+{
+public:
+    /** Called on every click and drag step with the target in seconds. */
+    std::function<void (double)> onSeek;
+
+    /** status: e.g. "Paused", or nullptr to show the time alone. It is
+        compared by content, so string literals are fine.
+    */
+    void update (double positionSeconds, double lengthSeconds, const char* status)
+    {
+        length = lengthSeconds;
+
+        if (isSeeking())
+        {
+            // Show where the user asked to go until the transport gets there
+            if (! dragging && (std::abs (positionSeconds - seekTarget) < 0.1 || --seekFramesLeft <= 0))
+                seekTarget = -1.0;
+            else
+                positionSeconds = seekTarget;
+        }
+
+        char newText[textSize];
+        formatTime (positionSeconds, newText);
+
+        const auto newFill = length > 0.0 ? juce::roundToInt (getWidth() * juce::jlimit (0.0, 1.0, positionSeconds / length)) : 0;
+        const auto statusChanged = (status == nullptr) != (currentStatus == nullptr)
+                                || (status != nullptr && std::strcmp (status, currentStatus) != 0);
+
+        if (newFill == fillWidth && ! statusChanged && std::strcmp (newText, text) == 0)
+            return;
+
+        fillWidth = newFill;
+        currentStatus = status;
+        std::memcpy (text, newText, sizeof (text));
+        repaint();
+    }
+
+    /** True while dragging, or while a seek hasn't reached the transport yet. */
+    bool isSeeking() const noexcept     { return seekTarget >= 0.0; }
+
+    //==============================================================================
+    void paint (juce::Graphics& g) override
+    {
+        const auto bounds = getLocalBounds();
+
+        g.setColour (findColour (juce::Slider::trackColourId).withMultipliedAlpha (0.6f));
+        g.fillRect (bounds.withWidth (fillWidth));
+
+        g.setColour (findColour (juce::Slider::trackColourId));
+        g.drawRect (bounds, 1);
+
+        g.setColour (findColour (juce::Label::textColourId));
+        g.setFont (font);
+
+        const auto textArea = bounds.reduced (6, 0);
+
+        if (currentStatus != nullptr)
+            g.drawText (currentStatus, textArea, juce::Justification::centredLeft);
+
+        g.drawText (text, textArea, juce::Justification::centredRight);
+    }
+
+    void resized() override
+    {
+        fillWidth = -1; // forces the next update() to repaint at the new width
+    }
+
+    void mouseDown (const juce::MouseEvent& e) override
+    {
+        dragging = true;
+        seekTo (e.x);
+    }
+
+    void mouseDrag (const juce::MouseEvent& e) override
+    {
+        seekTo (e.x);
+    }
+
+    void mouseUp (const juce::MouseEvent&) override
+    {
+        dragging = false;
+    }
+
+private:
+    static constexpr int textSize = 32;
+
+    /** h:mm:ss.mmm, hours unbounded; no allocation. */
+    static void formatTime (double seconds, char (&dest)[textSize]) noexcept
+    {
+        const auto totalMs = (juce::int64) (juce::jmax (0.0, seconds) * 1000.0);
+
+        std::snprintf (dest, textSize, "%d:%02d:%02d.%03d",
+                       (int) (totalMs / 3600000), (int) (totalMs / 60000 % 60),
+                       (int) (totalMs / 1000 % 60), (int) (totalMs % 1000));
+    }
+
+    void seekTo (int x)
+    {
+        if (length <= 0.0)
+            return;
+
+        seekTarget = length * juce::jlimit (0.0, 1.0, (double) x / (double) juce::jmax (1, getWidth()));
+        seekFramesLeft = 30;
+
+        if (onSeek != nullptr)
+            onSeek (seekTarget);
+
+        update (seekTarget, length, currentStatus);
+    }
+
+    char text[textSize] = "0:00:00.000";
+    const char* currentStatus = nullptr;
+    int fillWidth = 0;
+    double length = 0.0;
+
+    double seekTarget = -1.0;
+    int seekFramesLeft = 0;
+    bool dragging = false;
+
+    juce::Font font { juce::FontOptions (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain) };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SeekBar)
+};
@@ -0,0 +1,469 @@
+/*
+  ==============================================================================
+
+   SessionStore.h
+
+   Keeps a session ValueTree on disk, in two files:
+
+     session.umx          full snapshot, ValueTree binary format
+     session.umx.journal  records appended since, one per changed node,
+                          after a header holding the snapshot's checksum
+
+   Loading memory-maps both files and parses them in place. The snapshot
+   is read first, then the journal records are applied over it in order.
+   A journal whose checksum isn't the snapshot's is ignored: it is left
+   over from an older snapshot, e.g. after a crash between a rewrite of
+   the snapshot and the deletion of the journal.
+
+   While the session is attached, the nodes that change are noted. A
+   one-second timer serialises only those nodes, on the message thread.
+   The serialised data goes to a background writer, which appends it to
+   the journal. Once the journal outgrows the snapshot, the writer
+   rewrites the snapshot and empties the journal.
+
+   A record is the whole subtree of the changed node's ancestor at
+   journalDepth, so a change inside one track rewrites that track and
+   nothing else. A record cut short by a crash is ignored on load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class SessionStore  : private juce::ValueTree::Listener,
+                      private juce::Timer,
+                      private juce::Thread
+{
+public:
+    /** Changes are journaled per node at this depth: root = 0, its children = 1... */
+    static constexpr int journalDepth = 2;
+
+    explicit SessionStore (juce::File snapshotFile)
+        : juce::Thread ("Session writer"),
+          file (std::move (snapshotFile)),
+          journalFile (file.getSiblingFile (file.getFileName() + ".journal"))
+    {
+    }
+
+    ~SessionStore() override
+    {
+        detach();
+        stopThread (5000);
+    }
+
+    static juce::File getDefaultFile()
+    {
+        return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                 .getChildFile (juce::JUCEApplicationBase::getInstance() != nullptr
+                                    ? juce::JUCEApplicationBase::getInstance()->getApplicationName()
+                                    : juce::String ("PlayingSoundFilesTutorial"))
+                 .getChildFile ("session.umx");
+    }
+
+    //==============================================================================
+    /** Snapshot plus journal, or an invalid tree if there is no saved session. */
+    juce::ValueTree load() const
+    {
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        juce::ValueTree tree;
+        juce::uint64 checksum = 0;
+
+        {
+            const juce::MemoryMappedFile mapped (file, juce::MemoryMappedFile::readOnly);
+
+            if (mapped.getData() != nullptr)
+            {
+                tree = juce::ValueTree::readFromData (mapped.getData(), mapped.getSize());
+                checksum = getChecksum (mapped.getData(), mapped.getSize());
+            }
+        }
+
+        if (! tree.isValid())
+            return {};
+
+        const auto numRecords = replayJournal (tree, checksum);
+
+        juce::Logger::writeToLog (juce::String::formatted ("[session] loaded %s (+%d journal record(s)) in %.2f ms",
+                                                           file.getFileName().toRawUTF8(), numRecords,
+                                                           juce::Time::getMillisecondCounterHiRes() - startMs));
+        return tree;
+    }
+
+    /** Message thread. Starts journaling the tree's changes; the tree is
+        saved whole first so the journal has a snapshot to apply to.
+    */
+    void attach (juce::ValueTree& treeToWatch)
+    {
+        detach();
+        tree = treeToWatch;
+        tree.addListener (this);
+
+        post ({ {}, serialise (tree) });
+        startThread (juce::Thread::Priority::background);
+        startTimer (1000);
+    }
+
+    /** Message thread. Writes any pending change now and stops watching. */
+    void detach()
+    {
+        if (! tree.isValid())
+            return;
+
+        stopTimer();
+        flushChanges();
+        tree.removeListener (this);
+        tree = {};
+
+        // Let the writer finish what was queued
+        while (isThreadRunning() && hasPendingWrites())
+            juce::Thread::sleep (1);
+    }
+
+    //==============================================================================
+    /** Builds a large session (hundreds of tracks with analysis blobs), then
+        times a full save, a memory-mapped load and a one-track change.
+    */
+    static void runBenchmark (int numTracks = 500, int analysisBytesPerTrack = 64 * 1024)
+    {
+        const auto folder = juce::File::createTempFile ("session-benchmark");
+        folder.createDirectory();
+
+        {
+            juce::ValueTree session ("SESSION");
+            juce::ValueTree tracks ("TRACKS");
+            session.appendChild (tracks, nullptr);
+
+            juce::Random random (1);
+            juce::MemoryBlock analysis ((size_t) analysisBytesPerTrack);
+
+            for (int i = 0; i < numTracks; ++i)
+            {
+                random.fillBitsRandomly (analysis.getData(), analysis.getSize());
+
+                juce::ValueTree track ("TRACK");
+                track.setProperty ("file", "/audio/track" + juce::String (i) + ".wav", nullptr)
+                     .setProperty ("gain", 1.0, nullptr)
+                     .setProperty ("analysis", analysis, nullptr);
+                tracks.appendChild (track, nullptr);
+            }
+
+            SessionStore store (folder.getChildFile ("session.umx"));
+
+            auto startMs = juce::Time::getMillisecondCounterHiRes();
+            store.attach (session);
+            store.detach();
+            const auto saveMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+            // attach() queues a full save of its own: let it land before timing the change
+            store.attach (session);
+
+            while (store.hasPendingWrites())
+                juce::Thread::sleep (1);
+
+            startMs = juce::Time::getMillisecondCounterHiRes();
+            tracks.getChild (numTracks / 2).setProperty ("gain", 0.5, nullptr);
+            store.detach();
+            const auto changeMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+            juce::Logger::writeToLog (juce::String::formatted ("[session] %d tracks, %.1f MB: full save %.1f ms, one-track change %.2f ms (journal %d bytes)",
+                                                               numTracks, (double) store.file.getSize() / (1024.0 * 1024.0),
+                                                               saveMs, changeMs, (int) store.journalFile.getSize()));
+
+            const auto loaded = store.load();
+            jassertquiet (loaded.getChildWithName ("TRACKS").getChild (numTracks / 2)["gain"] == juce::var (0.5));
+        }
+
+        folder.deleteRecursively();
+    }
+
+private:
+    /** path: child indices from the root; empty = the whole tree. */
+    struct Write
+    {
+        juce::Array<int> path;
+        juce::MemoryBlock data;
+    };
+
+    //==============================================================================
+    // Message thread
+    void valueTreePropertyChanged (juce::ValueTree& node, const juce::Identifier&) override  { markChanged (node); }
+    void valueTreeChildAdded (juce::ValueTree& parent, juce::ValueTree&) override           { markChanged (parent); }
+    void valueTreeChildRemoved (juce::ValueTree& parent, juce::ValueTree&, int) override    { markChanged (parent); }
+    void valueTreeChildOrderChanged (juce::ValueTree& parent, int, int) override            { markChanged (parent); }
+
+    void markChanged (const juce::ValueTree& node)
+    {
+        auto unit = node;
+
+        while (unit.getParent().isValid() && getDepth (unit) > journalDepth)
+            unit = unit.getParent();
+
+        if (! changedNodes.contains (unit))
+            changedNodes.add (unit);
+    }
+
+    static int getDepth (juce::ValueTree node)
+    {
+        int depth = 0;
+
+        while ((node = node.getParent()).isValid())
+            ++depth;
+
+        return depth;
+    }
+
+    void timerCallback() override
+    {
+        flushChanges();
+    }
+
+    void flushChanges()
+    {
+        if (changedNodes.isEmpty())
+            return;
+
+        // A changed root, or a node that has since been detached, means the
+        // structure above the journal depth moved: save the lot
+        const auto wholeTree = std::any_of (changedNodes.begin(), changedNodes.end(),
+                                            [this] (const juce::ValueTree& n) { return n == tree || ! n.isAChildOf (tree); });
+
+        if (wholeTree)
+        {
+            post ({ {}, serialise (tree) });
+        }
+        else
+        {
+            for (const auto& node : changedNodes)
+                post ({ getPath (node), serialise (node) });
+        }
+
+        changedNodes.clearQuick();
+    }
+
+    static juce::Array<int> getPath (juce::ValueTree node)
+    {
+        juce::Array<int> path;
+
+        for (auto parent = node.getParent(); parent.isValid(); node = parent, parent = parent.getParent())
+            path.insert (0, parent.indexOf (node));
+
+        return path;
+    }
+
+    static juce::MemoryBlock serialise (const juce::ValueTree& node)
+    {
+        juce::MemoryOutputStream out;
+        node.writeToStream (out);
+        return out.getMemoryBlock();
+    }
+
+    //==============================================================================
+    // Writer thread
+    void post (Write&& write)
+    {
+        {
+            const juce::ScopedLock sl (queueLock);
+            queue.push_back (std::move (write));
+        }
+
+        notify();
+    }
+
+    bool hasPendingWrites() const
+    {
+        const juce::ScopedLock sl (queueLock);
+        return ! queue.empty() || writing;
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit() || hasPendingWrites())
+        {
+            std::vector<Write> batch;
+
+            {
+                const juce::ScopedLock sl (queueLock);
+                batch.swap (queue);
+                writing = ! batch.empty();
+            }
+
+            if (batch.empty())
+            {
+                wait (500);
+                continue;
+            }
+
+            for (auto& write : batch)
+            {
+                if (write.path.isEmpty())
+                    writeSnapshot (write.data);
+                else
+                    appendRecord (write);
+            }
+
+            compactIfNeeded();
+
+            const juce::ScopedLock sl (queueLock);
+            writing = false;
+        }
+    }
+
+    void writeSnapshot (const juce::MemoryBlock& data)
+    {
+        file.getParentDirectory().createDirectory();
+
+        // Replaced atomically, and the journal only once the new snapshot is in
+        const juce::TemporaryFile temp (file);
+
+        if (temp.getFile().replaceWithData (data.getData(), data.getSize()) && temp.overwriteTargetFileWithTemporary())
+        {
+            journalFile.deleteFile();
+            lastSnapshot = data;
+            lastSnapshotChecksum = getChecksum (data.getData(), data.getSize());
+            snapshotDirty = false;
+        }
+        else
+        {
+            juce::Logger::writeToLog ("[session] can't write " + file.getFullPathName());
+        }
+    }
+
+    /** Journal header: [uint32 journalMagic][uint64 snapshot checksum].
+        Record: [uint32 size][uint8 depth][int32 index]*depth[node]
+    */
+    void appendRecord (const Write& write)
+    {
+        juce::MemoryOutputStream record;
+        record.writeByte ((char) write.path.size());
+
+        for (auto index : write.path)
+            record.writeInt (index);
+
+        record.write (write.data.getData(), write.data.getSize());
+
+        const auto isNewJournal = journalFile.getSize() == 0;
+        juce::FileOutputStream out (journalFile);
+
+        if (out.openedOk())
+        {
+            if (isNewJournal)
+            {
+                out.writeInt ((int) journalMagic);
+                out.writeInt64 ((juce::int64) lastSnapshotChecksum);
+            }
+
+            out.writeInt ((int) record.getDataSize());
+            out.write (record.getData(), record.getDataSize());
+            out.flush();
+        }
+
+        snapshotDirty = true;
+    }
+
+    /** Folds the journal into a new snapshot once it has grown past it. */
+    void compactIfNeeded()
+    {
+        if (! snapshotDirty || journalFile.getSize() < juce::jmax ((juce::int64) 64 * 1024, file.getSize()))
+            return;
+
+        auto merged = juce::ValueTree::readFromData (lastSnapshot.getData(), lastSnapshot.getSize());
+
+        if (! merged.isValid())
+            merged = load();
+
+        if (merged.isValid())
+        {
+            replayJournal (merged, lastSnapshotChecksum);
+            writeSnapshot (serialise (merged));
+        }
+    }
+
+    /** Returns the number of records applied: none if the journal was written
+        over another snapshot than the one with this checksum.
+    */
+    int replayJournal (juce::ValueTree& target, juce::uint64 snapshotChecksum) const
+    {
+        const juce::MemoryMappedFile mapped (journalFile, juce::MemoryMappedFile::readOnly);
+
+        if (mapped.getData() == nullptr)
+            return 0;
+
+        juce::MemoryInputStream in (mapped.getData(), mapped.getSize(), false);
+
+        if (in.getNumBytesRemaining() < 12 || (juce::uint32) in.readInt() != journalMagic
+             || (juce::uint64) in.readInt64() != snapshotChecksum)
+        {
+            juce::Logger::writeToLog ("[session] journal belongs to another snapshot, ignoring it");
+            return 0;
+        }
+
+        int numRecords = 0;
+
+        while (in.getNumBytesRemaining() >= 4)
+        {
+            const auto size = in.readInt();
+
+            if (size <= 0 || size > in.getNumBytesRemaining())
+                break; // cut short by a crash
+
+            const auto* record = static_cast<const char*> (mapped.getData()) + in.getPosition();
+            in.skipNextBytes (size);
+
+            juce::MemoryInputStream recordIn (record, (size_t) size, false);
+            const auto depth = (int) (juce::uint8) recordIn.readByte();
+            auto parent = target;
+            int index = -1;
+
+            for (int i = 0; i < depth && parent.isValid(); ++i)
+            {
+                index = recordIn.readInt();
+
+                if (i < depth - 1)
+                    parent = parent.getChild (index);
+            }
+
+            const auto node = juce::ValueTree::readFromStream (recordIn);
+
+            if (! parent.isValid() || ! node.isValid() || ! juce::isPositiveAndBelow (index, parent.getNumChildren()))
+            {
+                juce::Logger::writeToLog ("[session] journal doesn't match the snapshot, ignoring the rest");
+                break;
+            }
+
+            parent.removeChild (index, nullptr);
+            parent.addChild (node, index, nullptr);
+            ++numRecords;
+        }
+
+        return numRecords;
+    }
+
+    /** 64-bit FNV-1a: enough to tell two snapshots apart, and quick on a few MB. */
+    static juce::uint64 getChecksum (const void* data, size_t size) noexcept
+    {
+        auto hash = (juce::uint64) 0xcbf29ce484222325ull;
+
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<const juce::uint8*> (data)[i]) * 0x100000001b3ull;
+
+        return hash;
+    }
+
+    //==============================================================================
+    static constexpr juce::uint32 journalMagic = 0x4a584d55; // "UMXJ"
+
+    const juce::File file, journalFile;
+
+    juce::ValueTree tree;
+    juce::Array<juce::ValueTree> changedNodes;
+
+    juce::CriticalSection queueLock;
+    std::vector<Write> queue;
+    bool writing = false;
+
+    juce::MemoryBlock lastSnapshot;     // writer thread only
+    juce::uint64 lastSnapshotChecksum = 0;
+    bool snapshotDirty = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionStore)
+};
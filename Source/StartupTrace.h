@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+   StartupTrace.h
+
+   Per-phase timing of the application start-up, written to the juce::Logger,
+   plus a small worker used to take slow initialisation off the message thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/** Logs how long each start-up phase took, relative to the moment begin() was
+    called in JUCEApplication::initialise().
+
+    Lines look like:
+        [startup]   12.41 ms  registerBasicFormats       (t =   18.02 ms, Startup)
+*/
+class StartupTrace
+{
+public:
+    static void begin() noexcept
+    {
+        originMs = juce::Time::getMillisecondCounterHiRes();
+    }
+
+    static double getElapsedMs() noexcept
+    {
+        return juce::Time::getMillisecondCounterHiRes() - originMs.load();
+    }
+
+    static void log (const juce::String& phase, double phaseMs)
+    {
+        auto* thread = juce::Thread::getCurrentThread();
+
+        juce::Logger::writeToLog (juce::String::formatted ("[startup] %8.2f ms  %-26s (t = %8.2f ms, ",
+                                                           phaseMs, phase.toRawUTF8(), getElapsedMs())
+                                  + (thread != nullptr ? thread->getThreadName() : juce::String ("message thread"))
+                                  + ")");
+    }
+
+    /** Marks a point in time, e.g. "window visible". */
+    static void mark (const juce::String& milestone)
+    {
+        log (milestone, 0.0);
+    }
+
+    //==============================================================================
+    /** Times the enclosing scope and logs it as one phase. */
+    class ScopedPhase
+    {
+    public:
+        explicit ScopedPhase (const char* phaseName) noexcept
+            : name (phaseName), startMs (juce::Time::getMillisecondCounterHiRes())
+        {
+        }
+
+        ~ScopedPhase()
+        {
+            log (name, juce::Time::getMillisecondCounterHiRes() - startMs);
+        }
+
+    private:
+        const char* name;
+        double startMs;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedPhase)
+    };
+
+private:
+    static inline std::atomic<double> originMs { juce::Time::getMillisecondCounterHiRes() };
+};
+
+//==============================================================================
+/** Runs a one-shot initialisation job on its own thread.
+
+    The destructor waits for the job to finish rather than interrupting it,
+    because the job typically opens MIDI ports or starts child processes. A job
+    still running after shutdownTimeoutMs (a blocked driver) is killed, so
+    quitting never hangs.
+*/
+class BackgroundStartup  : private juce::Thread
+{
+public:
+    static constexpr int shutdownTimeoutMs = 5000;
+
+    explicit BackgroundStartup (std::function<void()> jobToRun)
+        : juce::Thread ("Startup"), job (std::move (jobToRun))
+    {
+    }
+
+    ~BackgroundStartup() override
+    {
+        if (! stopThread (shutdownTimeoutMs))
+            juce::Logger::writeToLog ("[startup] job still running at shutdown: killed");
+    }
+
+    void start()    { startThread(); }
+
+private:
+    void run() override
+    {
+        job();
+    }
+
+    std::function<void()> job;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BackgroundStartup)
+};
@@ -0,0 +1,715 @@
+/*
+  ==============================================================================
+
+   StreamingSampler.h
+
+   Multi-sample instrument for libraries too big for RAM: a folder of audio
+   files, one per root note, each played across the keys up to halfway to
+   its neighbours.
+
+   Only the first preloadSeconds of each file lives in memory. It is read
+   through a memory-mapped reader when the format supports one, so loading
+   thousands of files means mapping and copying their heads and nothing
+   else. A note starts from that preload at once. Meanwhile a background
+   streamer thread fills the voice's own ring buffer with the rest of the
+   file, ahead of the play head. On each pass it serves the voice with the
+   least audio left in hand.
+
+   The audio thread never touches a file. If the streamer falls behind, the
+   missing frames are played as silence and counted as underruns.
+
+   Root notes are read from the end of the file name: "Cello_C4.wav",
+   "cello-F#2.aif" or "cello_60.wav" (C4 = 60). Files without one are
+   skipped.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LockFreeExchange.h"
+
+class StreamingSampler  : private juce::Thread,
+                          private juce::AsyncUpdater
+{
+public:
+    static constexpr int defaultNumVoices = 128;
+    static constexpr double defaultPreloadSeconds = 0.15;
+    static constexpr int ringSize = 1 << 14;        // frames per voice and channel
+    static constexpr int chunkSize = 2048;          // frames per disk read
+    static constexpr int maxChannels = 2;
+    static constexpr int maxOpenReaders = 128;
+
+    /** Message thread, once a library has been swapped in. */
+    std::function<void (int numZones, juce::int64 preloadBytes)> onLibraryLoaded;
+
+    explicit StreamingSampler (juce::AudioFormatManager& formats, int numVoicesToAllocate = defaultNumVoices)
+        : juce::Thread ("Sample streamer"),
+          formatManager (formats),
+          voices ((size_t) juce::jmax (1, numVoicesToAllocate))
+    {
+    }
+
+    ~StreamingSampler() override
+    {
+        stopThread (4000);
+        cancelPendingUpdate();
+    }
+
+    //==============================================================================
+    /** Message thread. Scanning and preloading happen on the streamer thread;
+        the current library keeps playing until the new one is ready.
+    */
+    void loadLibrary (const juce::File& folder, double preloadSeconds = defaultPreloadSeconds)
+    {
+        // The rings and the streamer thread only exist once a library is
+        // used: an engine that never loads one (a grid tile) costs neither
+        if (! isThreadRunning())
+        {
+            if (folder == juce::File{})
+                return;
+
+            for (auto& v : voices)
+                v.ring.setSize (maxChannels, ringSize);
+
+            startThread (juce::Thread::Priority::high);
+        }
+
+        const juce::ScopedLock sl (requestLock);
+        requestedFolder = folder;
+        requestedPreloadSeconds = preloadSeconds;
+        notify();
+    }
+
+    /** Message thread. */
+    void clearLibrary()                                 { loadLibrary ({}); }
+
+    bool hasLibrary() const noexcept                    { return libraryLoaded.load(); }
+    int getNumChannels() const noexcept                 { return libraryChannels.load(); }
+
+    //==============================================================================
+    // Any thread; queued for the next block
+    void noteOn (int note, float velocity) noexcept     { post ({ NoteEvent::Type::noteOn, note, velocity }); }
+    void noteOff (int note) noexcept                    { post ({ NoteEvent::Type::noteOff, note, 0.0f }); }
+    void allNotesOff() noexcept                         { post ({ NoteEvent::Type::allNotesOff, -1, 0.0f }); }
+
+    int getNumActiveVoices() const noexcept             { return numActiveVoices.load (std::memory_order_relaxed); }
+
+    //==============================================================================
+    void prepare (double newSampleRate, int samplesPerBlockExpected)
+    {
+        sampleRate = newSampleRate;
+        stealFadeSamples = juce::jmax (1, juce::roundToInt (newSampleRate * 0.005));
+        callbackLoad.reset (newSampleRate, samplesPerBlockExpected);
+
+        const juce::ScopedLock sl (libraryLock);
+
+        for (auto& v : voices)
+        {
+            v.envelope.setSampleRate (newSampleRate);
+            v.envelope.setParameters (envelopeParameters);
+            stopVoice (v);
+        }
+    }
+
+    /** Audio thread. Adds the voices into the first getNumChannels() channels
+        of the buffer.
+    */
+    void render (juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        const juce::AudioProcessLoadMeasurer::ScopedTimer timer (callbackLoad, numSamples);
+        const juce::ScopedTryLock stl (libraryLock); // only held while a library is swapped in
+
+        if (! stl.isLocked() || library == nullptr)
+            return;
+
+        runPendingNoteEvents();
+
+        int numActive = 0;
+
+        for (auto& v : voices)
+        {
+            if (v.isActive())
+            {
+                renderVoice (v, buffer, startSample, numSamples);
+                numActive += v.isActive() ? 1 : 0;
+            }
+        }
+
+        numActiveVoices.store (numActive, std::memory_order_relaxed);
+    }
+
+    /** Live CPU cost and streaming health, logged with the other load lines. */
+    void logProcessingLoad() const
+    {
+        juce::Logger::writeToLog (juce::String::formatted ("[stream] %d voice(s): %.2f %% of the block period, %.1f MB/s from disk, %d underrun(s)",
+                                                           getNumActiveVoices(), callbackLoad.getLoadAsProportion() * 100.0,
+                                                           diskBytesPerSecond.load() / (1024.0 * 1024.0), underruns.load()));
+    }
+
+private:
+    //==============================================================================
+    struct Zone
+    {
+        juce::File file;
+        int rootNote = 60;
+        double sampleRate = 44100.0;
+        juce::int64 length = 0;
+        int preloadLength = 0;
+        juce::AudioBuffer<float> preload;
+
+        // Streamer thread only; opened on first use, closed when least recently used
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        juce::uint32 lastUsed = 0;
+    };
+
+    struct Library
+    {
+        std::vector<std::unique_ptr<Zone>> zones;
+        std::array<Zone*, 128> keyMap {};
+        int numChannels = 0;
+        juce::int64 preloadBytes = 0;
+    };
+
+    /** The streamer and the audio thread agree on how far a voice's ring is
+        filled through one word: generation in the top bits, frames written
+        below. A voice that is restarted gets a new generation, so a read
+        started for its previous note can't be published into the new one.
+    */
+    static constexpr int writtenBits = 40;
+    static constexpr juce::uint64 writtenMask = (juce::uint64 (1) << writtenBits) - 1;
+
+    static juce::uint64 packStreamState (juce::uint32 generation, juce::int64 written) noexcept
+    {
+        return ((juce::uint64) generation << writtenBits) | ((juce::uint64) written & writtenMask);
+    }
+
+    struct Voice
+    {
+        // Audio thread
+        Zone* zone = nullptr;           // nullptr = free
+        int note = -1;
+        float gain = 0.0f;
+        double position = 0.0, increment = 1.0;
+        juce::ADSR envelope;
+        int fadeLeft = 0;
+        juce::uint32 age = 0, generation = 0;
+
+        // Shared with the streamer
+        juce::AudioBuffer<float> ring;
+        std::atomic<Zone*> streamZone { nullptr };
+        std::atomic<juce::uint64> streamState { 0 };
+        std::atomic<juce::int64> playFrame { 0 };   // oldest frame the audio thread may still read
+        std::atomic<double> streamIncrement { 1.0 };
+
+        bool isActive() const noexcept          { return zone != nullptr; }
+        bool isBeingStolen() const noexcept     { return fadeLeft > 0; }
+    };
+
+    struct NoteEvent
+    {
+        enum class Type { noteOn, noteOff, allNotesOff };
+
+        Type type = Type::allNotesOff;
+        int note = -1;
+        float velocity = 0.0f;
+    };
+
+    //==============================================================================
+    // Streamer thread
+    void run() override
+    {
+        auto lastRateUpdate = juce::Time::getMillisecondCounter();
+        juce::int64 bytesSinceUpdate = 0;
+
+        while (! threadShouldExit())
+        {
+            if (auto request = takeLibraryRequest())
+                swapLibrary (buildLibrary (request->first, request->second));
+
+            const auto bytes = streamNextChunk();
+            bytesSinceUpdate += bytes;
+
+            if (const auto now = juce::Time::getMillisecondCounter(); now - lastRateUpdate >= 1000)
+            {
+                diskBytesPerSecond = (double) bytesSinceUpdate * 1000.0 / (double) (now - lastRateUpdate);
+                bytesSinceUpdate = 0;
+                lastRateUpdate = now;
+            }
+
+            // Nothing to do: poll briskly while voices play, lazily when idle
+            // (a new note has its preload to play meanwhile)
+            if (bytes == 0)
+                wait (getNumActiveVoices() > 0 ? 2 : 40);
+        }
+    }
+
+    std::optional<std::pair<juce::File, double>> takeLibraryRequest()
+    {
+        const juce::ScopedLock sl (requestLock);
+
+        if (! requestedFolder.has_value())
+            return {};
+
+        auto request = std::make_pair (*requestedFolder, requestedPreloadSeconds);
+        requestedFolder.reset();
+        return request;
+    }
+
+    std::unique_ptr<Library> buildLibrary (const juce::File& folder, double preloadSeconds)
+    {
+        if (! folder.isDirectory())
+            return {};
+
+        const auto startMs = juce::Time::getMillisecondCounterHiRes();
+        auto newLibrary = std::make_unique<Library>();
+
+        for (const auto& entry : juce::RangedDirectoryIterator (folder, false, formatManager.getWildcardForAllFormats()))
+        {
+            if (threadShouldExit())
+                return {};
+
+            if (auto zone = createZone (entry.getFile(), preloadSeconds))
+            {
+                newLibrary->numChannels = juce::jmax (newLibrary->numChannels, zone->preload.getNumChannels());
+                newLibrary->preloadBytes += (juce::int64) zone->preload.getNumChannels() * zone->preload.getNumSamples() * (juce::int64) sizeof (float);
+                newLibrary->zones.push_back (std::move (zone));
+            }
+        }
+
+        if (newLibrary->zones.empty())
+        {
+            juce::Logger::writeToLog ("[stream] no samples with a root note in " + folder.getFullPathName());
+            return {};
+        }
+
+        std::sort (newLibrary->zones.begin(), newLibrary->zones.end(),
+                   [] (const auto& a, const auto& b) { return a->rootNote < b->rootNote; });
+
+        // Each key plays the zone whose root is nearest
+        for (int note = 0; note < 128; ++note)
+        {
+            auto* nearest = newLibrary->zones.front().get();
+
+            for (auto& zone : newLibrary->zones)
+                if (std::abs (zone->rootNote - note) < std::abs (nearest->rootNote - note))
+                    nearest = zone.get();
+
+            newLibrary->keyMap[(size_t) note] = nearest;
+        }
+
+        juce::Logger::writeToLog (juce::String::formatted ("[stream] %d zone(s), %.1f MB preloaded in %.0f ms",
+                                                           (int) newLibrary->zones.size(), (double) newLibrary->preloadBytes / (1024.0 * 1024.0),
+                                                           juce::Time::getMillisecondCounterHiRes() - startMs));
+        return newLibrary;
+    }
+
+    std::unique_ptr<Zone> createZone (const juce::File& file, double preloadSeconds)
+    {
+        const auto rootNote = parseRootNote (file.getFileNameWithoutExtension());
+
+        if (rootNote < 0)
+            return {};
+
+        auto* format = formatManager.findFormatForFileExtension (file.getFileExtension());
+
+        if (format == nullptr)
+            return {};
+
+        // Memory-mapped when the format allows it: only the head gets mapped and
+        // copied, the rest of the file is never touched here
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        if (std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped { format->createMemoryMappedReader (file) })
+        {
+            const auto headLength = juce::jmin (mapped->lengthInSamples, (juce::int64) (mapped->sampleRate * preloadSeconds));
+
+            if (mapped->mapSectionOfFile ({ 0, headLength }))
+                reader = std::move (mapped);
+        }
+
+        if (reader == nullptr)
+            reader.reset (formatManager.createReaderFor (file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+            return {};
+
+        auto zone = std::make_unique<Zone>();
+        zone->file = file;
+        zone->rootNote = rootNote;
+        zone->sampleRate = reader->sampleRate;
+        zone->length = juce::jmin (reader->lengthInSamples, (juce::int64) writtenMask);
+        zone->preloadLength = (int) juce::jmin (zone->length, (juce::int64) (reader->sampleRate * preloadSeconds));
+
+        zone->preload.setSize ((int) juce::jmin (reader->numChannels, (unsigned int) maxChannels), zone->preloadLength);
+        reader->read (&zone->preload, 0, zone->preloadLength, 0, true, true);
+
+        return zone;
+    }
+
+    /** Trailing MIDI number or note name, C4 = 60; -1 if there is none. */
+    static int parseRootNote (const juce::String& name)
+    {
+        const auto token = juce::StringArray::fromTokens (name, "_- .", {}).strings.getLast().trim();
+
+        if (token.containsOnly ("0123456789"))
+            return token.isNotEmpty() && token.getIntValue() < 128 ? token.getIntValue() : -1;
+
+        const auto letter = juce::String ("CDEFGAB").indexOfChar (juce::CharacterFunctions::toUpperCase (token[0]));
+
+        if (letter < 0)
+            return -1;
+
+        static constexpr int semitones[] { 0, 2, 4, 5, 7, 9, 11 };
+        auto note = semitones[letter];
+        auto rest = token.substring (1);
+
+        if (rest.startsWithChar ('#'))      { ++note; rest = rest.substring (1); }
+        else if (rest.startsWithChar ('b')) { --note; rest = rest.substring (1); }
+
+        if (rest.isEmpty() || ! rest.containsOnly ("0123456789"))
+            return -1;
+
+        note += (rest.getIntValue() + 1) * 12;
+        return juce::isPositiveAndBelow (note, 128) ? note : -1;
+    }
+
+    void swapLibrary (std::unique_ptr<Library> newLibrary)
+    {
+        {
+            const juce::ScopedLock sl (libraryLock);
+            library.swap (newLibrary);
+
+            for (auto& v : voices)
+                stopVoice (v);
+        }
+
+        libraryChannels = library != nullptr ? library->numChannels : 0;
+        loadedZones = library != nullptr ? (int) library->zones.size() : 0;
+        loadedPreloadBytes = library != nullptr ? library->preloadBytes : 0;
+        libraryLoaded = library != nullptr;
+        triggerAsyncUpdate();
+        // newLibrary (the old one) and its open readers go away here, off the audio thread
+    }
+
+    void handleAsyncUpdate() override
+    {
+        if (onLibraryLoaded != nullptr)
+            onLibraryLoaded (loadedZones.load(), loadedPreloadBytes.load());
+    }
+
+    /** Refills the ring of the voice closest to running dry. Returns the
+        number of bytes read, 0 if no voice needed anything.
+    */
+    juce::int64 streamNextChunk()
+    {
+        Voice* mostUrgent = nullptr;
+        double leastAhead = 0.0;
+
+        for (auto& v : voices)
+        {
+            auto* zone = v.streamZone.load (std::memory_order_acquire);
+            const auto state = v.streamState.load (std::memory_order_acquire);
+            const auto written = (juce::int64) (state & writtenMask);
+
+            if (zone == nullptr || written >= zone->length)
+                continue;
+
+            const auto playFrame = v.playFrame.load (std::memory_order_acquire);
+
+            if (ringSize - (written - playFrame) < chunkSize && zone->length - written > chunkSize)
+                continue; // still plenty in hand
+
+            // Output samples left before this voice hits the end of what is written
+            const auto ahead = (double) (written - playFrame) / juce::jmax (1.0e-6, v.streamIncrement.load());
+
+            if (mostUrgent == nullptr || ahead < leastAhead)
+            {
+                mostUrgent = &v;
+                leastAhead = ahead;
+            }
+        }
+
+        return mostUrgent != nullptr ? fillRing (*mostUrgent) : 0;
+    }
+
+    juce::int64 fillRing (Voice& v)
+    {
+        const auto state = v.streamState.load (std::memory_order_acquire);
+        auto* zone = v.streamZone.load (std::memory_order_acquire);
+
+        if (zone == nullptr)
+            return 0;
+
+        auto* reader = getReader (*zone);
+
+        if (reader == nullptr)
+            return 0;
+
+        const auto written = (juce::int64) (state & writtenMask);
+        const auto free = ringSize - (written - v.playFrame.load (std::memory_order_acquire));
+        const auto num = (int) juce::jmin ((juce::int64) chunkSize, free, zone->length - written);
+
+        if (num <= 0)
+            return 0;
+
+        // At most two reads: up to the end of the ring, then from its start
+        const auto ringPos = (int) (written % ringSize);
+        const auto first = juce::jmin (num, ringSize - ringPos);
+
+        reader->read (&v.ring, ringPos, first, written, true, true);
+
+        if (first < num)
+            reader->read (&v.ring, 0, num - first, written + first, true, true);
+
+        // Publish, unless the voice was restarted meanwhile
+        auto expected = state;
+        v.streamState.compare_exchange_strong (expected, packStreamState ((juce::uint32) (state >> writtenBits), written + num),
+                                               std::memory_order_acq_rel);
+
+        return (juce::int64) num * reader->numChannels * reader->bitsPerSample / 8;
+    }
+
+    juce::AudioFormatReader* getReader (Zone& zone)
+    {
+        zone.lastUsed = ++readerClock;
+
+        if (zone.reader != nullptr)
+            return zone.reader.get();
+
+        // Thousands of zones can't all keep a file handle open
+        if (numOpenReaders >= maxOpenReaders)
+        {
+            Zone* oldest = nullptr;
+
+            for (auto& z : library->zones)
+                if (z->reader != nullptr && (oldest == nullptr || z->lastUsed < oldest->lastUsed))
+                    oldest = z.get();
+
+            if (oldest != nullptr)
+            {
+                oldest->reader.reset();
+                --numOpenReaders;
+            }
+        }
+
+        zone.reader.reset (formatManager.createReaderFor (zone.file));
+        numOpenReaders += zone.reader != nullptr ? 1 : 0;
+        return zone.reader.get();
+    }
+
+    //==============================================================================
+    // Audio thread
+    void post (const NoteEvent& event) noexcept
+    {
+        const juce::SpinLock::ScopedLockType sl (eventWriterLock);
+
+        int start1, size1, start2, size2;
+        noteEvents.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            events[(size_t) start1] = event;
+            noteEvents.finishedWrite (1);
+        }
+    }
+
+    void runPendingNoteEvents() noexcept
+    {
+        const auto numReady = noteEvents.getNumReady();
+
+        if (numReady == 0)
+            return;
+
+        int start1, size1, start2, size2;
+        noteEvents.prepareToRead (numReady, start1, size1, start2, size2);
+
+        for (int i = 0; i < size1 + size2; ++i)
+        {
+            const auto& event = events[(size_t) (i < size1 ? start1 + i : start2 + i - size1)];
+
+            switch (event.type)
+            {
+                case NoteEvent::Type::noteOn:       startVoice (event.note, event.velocity); break;
+                case NoteEvent::Type::noteOff:      releaseVoices (event.note); break;
+                case NoteEvent::Type::allNotesOff:  releaseVoices (-1); break;
+            }
+        }
+
+        noteEvents.finishedRead (size1 + size2);
+    }
+
+    void startVoice (int note, float velocity) noexcept
+    {
+        auto* zone = library->keyMap[(size_t) juce::jlimit (0, 127, note)];
+        auto* voice = findFreeVoice();
+
+        if (voice == nullptr)
+        {
+            voice = stealVoice();
+
+            if (voice == nullptr)
+                voice = &*std::min_element (voices.begin(), voices.end(),
+                                            [] (const Voice& a, const Voice& b) { return a.fadeLeft < b.fadeLeft; });
+        }
+
+        voice->zone = zone;
+        voice->note = note;
+        voice->gain = juce::jlimit (0.0f, 1.0f, velocity);
+        voice->position = 0.0;
+        voice->increment = zone->sampleRate / sampleRate * std::pow (2.0, (note - zone->rootNote) / 12.0);
+        voice->fadeLeft = 0;
+        voice->age = nextAge++;
+        voice->envelope.reset();
+        voice->envelope.noteOn();
+
+        // Zone first, then the state that makes it valid (see streamNextChunk)
+        voice->playFrame.store (0, std::memory_order_relaxed);
+        voice->streamIncrement.store (voice->increment, std::memory_order_relaxed);
+        voice->streamZone.store (zone->preloadLength < zone->length ? zone : nullptr, std::memory_order_release);
+        voice->streamState.store (packStreamState (++voice->generation, zone->preloadLength), std::memory_order_release);
+
+        if (findFreeVoice() == nullptr)
+            stealVoice();
+    }
+
+    void stopVoice (Voice& v) noexcept
+    {
+        v.zone = nullptr;
+        v.note = -1;
+        v.fadeLeft = 0;
+        v.envelope.reset();
+        v.streamZone.store (nullptr, std::memory_order_release);
+        v.streamState.store (packStreamState (++v.generation, 0), std::memory_order_release);
+    }
+
+    Voice* findFreeVoice() noexcept
+    {
+        for (auto& v : voices)
+            if (! v.isActive())
+                return &v;
+
+        return nullptr;
+    }
+
+    Voice* stealVoice() noexcept
+    {
+        Voice* oldest = nullptr;
+
+        for (auto& v : voices)
+            if (v.isActive() && ! v.isBeingStolen() && (oldest == nullptr || v.age - oldest->age > 0x80000000u))
+                oldest = &v;
+
+        if (oldest != nullptr)
+            oldest->fadeLeft = stealFadeSamples;
+
+        return oldest;
+    }
+
+    void releaseVoices (int note) noexcept
+    {
+        for (auto& v : voices)
+            if (v.isActive() && (note < 0 || v.note == note))
+                v.envelope.noteOff();
+    }
+
+    /** Frame from the preload, or from the ring once past it. */
+    float getFrame (const Voice& v, int channel, juce::int64 frame, juce::int64 written) noexcept
+    {
+        const auto& zone = *v.zone;
+
+        if (frame < 0 || frame >= zone.length || zone.preload.getNumChannels() == 0)
+            return 0.0f;
+
+        // A mono zone in a stereo library plays on both sides
+        channel = juce::jmin (channel, zone.preload.getNumChannels() - 1);
+
+        if (frame < zone.preloadLength)
+            return zone.preload.getSample (channel, (int) frame);
+
+        if (frame >= written)
+        {
+            ++missingFrames;
+            return 0.0f;
+        }
+
+        return v.ring.getSample (channel, (int) (frame % ringSize));
+    }
+
+    void renderVoice (Voice& v, juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+    {
+        const auto written = (juce::int64) (v.streamState.load (std::memory_order_acquire) & writtenMask);
+        const auto numChannels = juce::jmin (buffer.getNumChannels(), maxChannels);
+        missingFrames = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (v.position >= (double) v.zone->length || ! v.envelope.isActive() || (v.isBeingStolen() && --v.fadeLeft == 0))
+            {
+                stopVoice (v);
+                break;
+            }
+
+            const auto frame = (juce::int64) v.position;
+            const auto t = (float) (v.position - (double) frame);
+            const auto amp = v.gain * v.envelope.getNextSample()
+                               * (v.isBeingStolen() ? (float) v.fadeLeft / (float) stealFadeSamples : 1.0f);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                // Same 4-point Hermite as Sampler, one sample at a time
+                const auto xm1 = getFrame (v, ch, frame - 1, written), x0 = getFrame (v, ch, frame, written),
+                           x1  = getFrame (v, ch, frame + 1, written), x2 = getFrame (v, ch, frame + 2, written);
+
+                const auto c1 = 0.5f * (x1 - xm1);
+                const auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                const auto c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+                buffer.addSample (ch, startSample + i, amp * (((c3 * t + c2) * t + c1) * t + x0));
+            }
+
+            v.position += v.increment;
+        }
+
+        if (missingFrames > 0)
+            underruns.fetch_add (1, std::memory_order_relaxed);
+
+        if (v.isActive())
+            v.playFrame.store ((juce::int64) v.position - 1, std::memory_order_release);
+    }
+
+    //==============================================================================
+    juce::AudioFormatManager& formatManager;
+    std::vector<Voice> voices;
+
+    std::unique_ptr<Library> library;   // replaced by the streamer thread only
+    juce::CriticalSection libraryLock;  // held by render(), and by the streamer while swapping
+    std::atomic<bool> libraryLoaded { false };
+    std::atomic<int> libraryChannels { 0 }, loadedZones { 0 };
+    std::atomic<juce::int64> loadedPreloadBytes { 0 };
+
+    juce::CriticalSection requestLock;
+    std::optional<juce::File> requestedFolder;
+    double requestedPreloadSeconds = defaultPreloadSeconds;
+
+    int numOpenReaders = 0;
+    juce::uint32 readerClock = 0;
+
+    double sampleRate = 44100.0;
+    int stealFadeSamples = 1;
+    juce::uint32 nextAge = 0;
+    int missingFrames = 0;
+
+    static constexpr int queueSize = 256;
+    juce::AbstractFifo noteEvents { queueSize };
+    std::array<NoteEvent, queueSize> events {};
+    juce::SpinLock eventWriterLock;
+
+    juce::ADSR::Parameters envelopeParameters { 0.005f, 0.1f, 0.8f, 0.3f };
+
+    std::atomic<int> numActiveVoices { 0 }, underruns { 0 };
+    std::atomic<double> diskBytesPerSecond { 0.0 };
+    juce::AudioProcessLoadMeasurer callbackLoad;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StreamingSampler)
+};
@@ -0,0 +1,382 @@
+/*
+  ==============================================================================
+
+   TimeStretchSource.h
+
+   Phase-vocoder time-stretch that sits between the reader source and the
+   AudioTransportSource, so playback speed changes without changing pitch.
+
+   The transport keeps doing its usual sample-rate correction; positions seen
+   through this source are in source samples, so the transport's position,
+   looping and end-of-file handling stay correct at any speed.
+
+   Every buffer is allocated in prepareToPlay() or setQuality(); the FFTs are
+   juce::dsp::FFT, which uses the platform's vectorised backend where there
+   is one, and windowing and overlap-add use FloatVectorOperations. The
+   per-bin polar conversion (atan2, sin, cos) is plain scalar libm: neither
+   JUCE nor the standard library has a vectorised form, and an approximation
+   would colour the phase propagation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class TimeStretchSource  : public juce::PositionableAudioSource
+{
+public:
+    /** FFT size trades CPU and latency against transient smearing. */
+    enum class Quality { fast = 10, normal = 11, high = 12 };
+
+    TimeStretchSource (juce::PositionableAudioSource& sourceToStretch, int numChannelsToProcess)
+        : source (sourceToStretch), maxChannels (juce::jlimit (1, 64, numChannelsToProcess))
+    {
+    }
+
+    /** 0.5 = half speed, 2.0 = double speed. At exactly 1.0 the source is passed
+        through untouched, after a crossfade of one hop when coming out of a
+        stretch. Safe to call from any thread.
+    */
+    void setSpeed (double newSpeed) noexcept        { speed = juce::jlimit (0.25, 4.0, newSpeed); }
+    double getSpeed() const noexcept                { return speed; }
+
+    /** Not real-time safe: reallocates, so call it before playback starts. */
+    void setQuality (Quality newQuality)
+    {
+        quality = newQuality;
+
+        if (preparedBlockSize > 0)
+            allocate();
+    }
+
+    //==============================================================================
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
+    {
+        preparedBlockSize = samplesPerBlockExpected;
+        source.prepareToPlay (samplesPerBlockExpected, sampleRate);
+        loadMeasurer.reset (sampleRate, samplesPerBlockExpected);
+        allocate();
+    }
+
+    void releaseResources() override
+    {
+        source.releaseResources();
+    }
+
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override
+    {
+        const auto currentSpeed = speed.load();
+
+        if (currentSpeed == 1.0 || fftSize == 0)
+        {
+            if (! stretching)
+            {
+                source.getNextAudioBlock (info);
+                return;
+            }
+
+            // Back to the source where the stretcher had got to, not where it
+            // started, crossfading from what the stretcher would have played next
+            const auto numChannels = juce::jmin (info.buffer->getNumChannels(), maxChannels);
+            const auto fadeLength = juce::jmin (info.numSamples, synthesisHop);
+            const auto fromOutput = juce::jmin (fadeLength, outputAvailable);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                crossfade.copyFrom (ch, 0, output, ch, outputReadPos, fromOutput);
+                crossfade.copyFrom (ch, fromOutput, accumulator, ch, 0, fadeLength - fromOutput);
+            }
+
+            source.setNextReadPosition (getNextReadPosition());
+            stretching = false;
+            source.getNextAudioBlock (info);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                info.buffer->applyGainRamp (ch, info.startSample, fadeLength, 0.0f, 1.0f);
+                info.buffer->addFromWithRamp (ch, info.startSample, crossfade.getReadPointer (ch), fadeLength, 1.0f, 0.0f);
+            }
+
+            return;
+        }
+
+        if (! stretching)
+            resync (source.getNextReadPosition());
+
+        const juce::AudioProcessLoadMeasurer::ScopedTimer timer (loadMeasurer, info.numSamples);
+        const auto numChannels = juce::jmin (info.buffer->getNumChannels(), maxChannels);
+        analysisHop = (double) synthesisHop * currentSpeed;
+
+        for (int done = 0; done < info.numSamples;)
+        {
+            if (outputAvailable == 0)
+                produceFrame (numChannels);
+
+            const auto num = juce::jmin (info.numSamples - done, outputAvailable);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                info.buffer->copyFrom (ch, info.startSample + done, output, ch, outputReadPos, num);
+
+            outputReadPos += num;
+            outputAvailable -= num;
+            done += num;
+        }
+
+        for (int ch = numChannels; ch < info.buffer->getNumChannels(); ++ch)
+            info.buffer->clear (ch, info.startSample, info.numSamples);
+    }
+
+    //==============================================================================
+    void setNextReadPosition (juce::int64 newPosition) override
+    {
+        source.setNextReadPosition (newPosition);
+        stretching = false;
+    }
+
+    juce::int64 getNextReadPosition() const override
+    {
+        if (! stretching.load())
+            return source.getNextReadPosition();
+
+        // The wrapped source wraps around by itself when looping
+        const auto length = getTotalLength();
+        const auto pos = (juce::int64) analysisPosition.load();
+        return isLooping() && length > 0 ? pos % length : pos;
+    }
+
+    /** Fraction of one core used by the stretcher for this stream (all channels). */
+    double getLoadAsProportion() const              { return loadMeasurer.getLoadAsProportion(); }
+
+    juce::int64 getTotalLength() const override     { return source.getTotalLength(); }
+    bool isLooping() const override                 { return source.isLooping(); }
+    void setLooping (bool shouldLoop) override      { source.setLooping (shouldLoop); }
+
+    //==============================================================================
+    /** Stretches a looping stereo noise source at each quality and a few
+        speeds, in fixed blocks, and logs how many such streams fit on a core.
+    */
+    static void runBenchmark()
+    {
+        constexpr double benchmarkRate = 48000.0;
+        constexpr int blockSize = 512, numBlocks = 1000, numChannels = 2;
+        const auto blockMs = blockSize * 1000.0 / benchmarkRate;
+
+        juce::AudioBuffer<float> noise (numChannels, (int) benchmarkRate * 4);
+        juce::Random random (1);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (ch, i, random.nextFloat() * 0.5f - 0.25f);
+
+        juce::AudioBuffer<float> buffer (numChannels, blockSize);
+
+        for (auto benchmarkQuality : { Quality::fast, Quality::normal, Quality::high })
+        {
+            for (auto benchmarkSpeed : { 0.5, 0.8, 1.25, 2.0 })
+            {
+                juce::MemoryAudioSource memory (noise, false, true);
+                TimeStretchSource stretcher (memory, numChannels);
+                stretcher.setQuality (benchmarkQuality);
+                stretcher.setSpeed (benchmarkSpeed);
+                stretcher.prepareToPlay (blockSize, benchmarkRate);
+
+                double totalSeconds = 0.0;
+
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    const juce::AudioSourceChannelInfo info (&buffer, 0, blockSize);
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    stretcher.getNextAudioBlock (info);
+                    totalSeconds += juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+                }
+
+                stretcher.releaseResources();
+                const auto meanMs = totalSeconds * 1000.0 / numBlocks;
+
+                juce::Logger::writeToLog (juce::String::formatted ("[stretch] FFT %4d  %.2fx  %6.3f ms per %.2f ms block  (%5.1f %%)  ~%d stereo streams per core",
+                                                                   1 << (int) benchmarkQuality, benchmarkSpeed, meanMs, blockMs,
+                                                                   meanMs * 100.0 / blockMs,
+                                                                   meanMs > 0.0 ? (int) (blockMs / meanMs) : 0));
+            }
+        }
+    }
+
+private:
+
+    //==============================================================================
+    void allocate()
+    {
+        const auto order = (int) quality;
+        fft = std::make_unique<juce::dsp::FFT> (order);
+        fftSize = 1 << order;
+        synthesisHop = fftSize / 4;
+
+        window.resize ((size_t) fftSize);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables (window.data(), (size_t) fftSize,
+                                                                  juce::dsp::WindowingFunction<float>::hann, false);
+
+        // Hann analysis + synthesis windows at 75% overlap sum to 1.5
+        const auto overlapGain = 1.0f / 1.5f;
+        synthesisWindow = window;
+        juce::FloatVectorOperations::multiply (synthesisWindow.data(), overlapGain, fftSize);
+
+        // Enough input for one frame plus the largest analysis hop
+        inputCapacity = fftSize * 6;
+        input.setSize (maxChannels, inputCapacity);
+        readBuffer.setSize (maxChannels, juce::jmax (preparedBlockSize, fftSize * 4));
+        output.setSize (maxChannels, synthesisHop);
+        crossfade.setSize (maxChannels, synthesisHop);
+        accumulator.setSize (maxChannels, fftSize);
+        fftData.setSize (1, fftSize * 2);
+
+        const auto numBins = fftSize / 2 + 1;
+        previousPhase.setSize (maxChannels, numBins);
+        synthesisPhase.setSize (maxChannels, numBins);
+        magnitude.resize ((size_t) numBins);
+        phase.resize ((size_t) numBins);
+
+        stretching = false;
+    }
+
+    void resync (juce::int64 position)
+    {
+        source.setNextReadPosition (position);
+        analysisPosition = (double) position;
+        inputStart = position;
+        inputFill = 0;
+        outputAvailable = 0;
+        outputReadPos = 0;
+        firstFrame = true;
+
+        accumulator.clear();
+        previousPhase.clear();
+        synthesisPhase.clear();
+        stretching = true;
+    }
+
+    /** Makes sure input holds [frameStart, frameStart + fftSize). */
+    void fillInput (juce::int64 frameStart, int numChannels)
+    {
+        // Drop what's already behind the frame
+        if (const auto consumed = (int) juce::jlimit ((juce::int64) 0, (juce::int64) inputFill, frameStart - inputStart); consumed > 0)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                std::memmove (input.getWritePointer (ch), input.getReadPointer (ch, consumed),
+                              (size_t) (inputFill - consumed) * sizeof (float));
+
+            inputFill -= consumed;
+            inputStart += consumed;
+        }
+
+        while (inputFill < fftSize)
+        {
+            const auto num = juce::jmin (readBuffer.getNumSamples(), inputCapacity - inputFill);
+            juce::AudioSourceChannelInfo info (&readBuffer, 0, num);
+            source.getNextAudioBlock (info);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                input.copyFrom (ch, inputFill, readBuffer, ch, 0, num);
+
+            inputFill += num;
+        }
+    }
+
+    void produceFrame (int numChannels)
+    {
+        const auto frameStart = (juce::int64) analysisPosition.load();
+        fillInput (frameStart, numChannels);
+
+        const auto numBins = fftSize / 2 + 1;
+        const auto twoPi = juce::MathConstants<double>::twoPi;
+        auto* data = fftData.getWritePointer (0);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            // Analysis
+            juce::FloatVectorOperations::multiply (data, input.getReadPointer (ch, (int) (frameStart - inputStart)),
+                                                   window.data(), fftSize);
+            juce::FloatVectorOperations::clear (data + fftSize, fftSize);
+            fft->performRealOnlyForwardTransform (data, true);
+
+            auto* prev  = previousPhase.getWritePointer (ch);
+            auto* synth = synthesisPhase.getWritePointer (ch);
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const auto re = data[2 * k], im = data[2 * k + 1];
+                magnitude[(size_t) k] = std::sqrt (re * re + im * im);
+                phase[(size_t) k] = std::atan2 (im, re);
+            }
+
+            // Phase propagation: each bin's true frequency from the analysis
+            // phase advance, re-accumulated over the synthesis hop.
+            for (int k = 0; k < numBins; ++k)
+            {
+                const auto omega = twoPi * k / fftSize;
+                const auto p = (double) phase[(size_t) k];
+
+                if (firstFrame)
+                {
+                    synth[k] = (float) p;
+                }
+                else
+                {
+                    auto delta = p - prev[k] - omega * analysisHop;
+                    delta -= twoPi * std::round (delta / twoPi);
+                    const auto trueFrequency = omega + delta / analysisHop;
+                    synth[k] = (float) std::remainder (synth[k] + trueFrequency * synthesisHop, twoPi);
+                }
+
+                prev[k] = (float) p;
+            }
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                data[2 * k]     = magnitude[(size_t) k] * std::cos (synth[k]);
+                data[2 * k + 1] = magnitude[(size_t) k] * std::sin (synth[k]);
+            }
+
+            // Synthesis: overlap-add one hop's worth into the output
+            fft->performRealOnlyInverseTransform (data);
+            juce::FloatVectorOperations::multiply (data, synthesisWindow.data(), fftSize);
+
+            auto* acc = accumulator.getWritePointer (ch);
+            juce::FloatVectorOperations::add (acc, data, fftSize);
+            juce::FloatVectorOperations::copy (output.getWritePointer (ch), acc, synthesisHop);
+
+            std::memmove (acc, acc + synthesisHop, (size_t) (fftSize - synthesisHop) * sizeof (float));
+            juce::FloatVectorOperations::clear (acc + fftSize - synthesisHop, synthesisHop);
+        }
+
+        firstFrame = false;
+        analysisPosition.store (analysisPosition.load() + analysisHop); // only the audio thread writes
+        outputReadPos = 0;
+        outputAvailable = synthesisHop;
+    }
+
+    //==============================================================================
+    juce::PositionableAudioSource& source;
+    const int maxChannels;
+
+    std::atomic<double> speed { 1.0 };
+    Quality quality = Quality::normal;
+    int preparedBlockSize = 0;
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int fftSize = 0, synthesisHop = 0;
+    double analysisHop = 0.0;
+
+    std::vector<float> window, synthesisWindow, magnitude, phase;
+    juce::AudioBuffer<float> input, readBuffer, output, crossfade, accumulator, fftData, previousPhase, synthesisPhase;
+
+    int inputCapacity = 0, inputFill = 0;
+    juce::int64 inputStart = 0;
+    std::atomic<double> analysisPosition { 0.0 };   // read by getNextReadPosition() from any thread
+    int outputReadPos = 0, outputAvailable = 0;
+    std::atomic<bool> stretching { false };
+    bool firstFrame = true;
+
+    juce::AudioProcessLoadMeasurer loadMeasurer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeStretchSource)
+};
@@ -32,9 +32,11 @@ description:      Plays audio files.
 dependencies:     juce_audio_basics, juce_audio_devices, juce_audio_formats,
                   juce_audio_processors, juce_audio_utils, juce_core,
                   juce_data_structures, juce_events, juce_graphics,
-                  juce_gui_basics, juce_gui_extra
+                  juce_dsp, juce_gui_basics, juce_gui_extra, juce_opengl, juce_osc
 exporters:        xcode_mac, vs2019, linux_make
 
+moduleFlags:      JUCE_PLUGINHOST_VST3=1, JUCE_PLUGINHOST_LV2=1
+
 type:             Component
 mainClass:        MainContentComponent
 
@@ -47,6 +49,20 @@ END_JUCE_PIP_METADATA
 
 #pragma once
 
+#include "StartupTrace.h"
+#include "ImageAssetCache.h"
+#include "OpenGLMeterRenderer.h"
+#include "AnimationScheduler.h"
+#include "ButtonSkinCache.h"
+#include "PlayerEngine.h"
+#include "ExportJob.h"
+#include "SeekBar.h"
+#include "RemoteControl.h"
+#include "ControlInput.h"
+#include "PluginScanner.h"
+#include "SessionStore.h"
+#include "InputRecorder.h"
+
 class UnixMatrixLookAndFeel : public juce::LookAndFeel_V4
 {
 public:
@@ -99,12 +115,20 @@ public:
                               bool isHovered,
                               bool isDown) override
    {
-       auto bounds = button.getLocalBounds().toFloat();
-       auto base   = backgroundColour;
+       buttonSkin.draw (g, button.getLocalBounds(), backgroundColour,
+                        ButtonSkinCache::getState (button, isHovered, isDown));
+   }
 
-       if (isDown)
+private:
+   // Tracé vectoriel, rastérisé une fois par couleur / état / échelle
+   void paintButtonSkin (juce::Graphics& g, juce::Rectangle<float> bounds,
+                         juce::Colour backgroundColour, ButtonSkinCache::State state)
+   {
+       auto base = backgroundColour;
+
+       if (state == ButtonSkinCache::State::down)
            base = base.darker (0.2f);
-       else if (isHovered)
+       else if (state == ButtonSkinCache::State::hover)
            base = base.brighter (0.1f);
 
        g.setColour (base);
@@ -114,28 +138,40 @@ public:
        g.drawRect (bounds, 1.0f);
    }
 
-private:
    // Palette Matrix / terminal
    juce::Colour background { juce::Colours::black };
    juce::Colour darkShadow { juce::Colour::fromRGB (0, 120, 40) };  // vert plus sombre
    juce::Colour lightEdge  { juce::Colour::fromRGB (0, 220, 80) };  // vert lumineux
    juce::Colour textColour { juce::Colour::fromRGB (0, 255, 70) };  // vert Matrix
+
+   ButtonSkinCache buttonSkin { 2, [this] (auto& g, auto bounds, auto colour, auto state)
+                                   { paintButtonSkin (g, bounds, colour, state); } };
 };
 
 //==============================================================================
 class MainContentComponent   : public juce::AudioAppComponent,
-                              public juce::ChangeListener,
-                              public juce::Timer
+                              private PlayerEngine::Listener,
+                              private juce::ValueTree::Listener
 {
 public:
    MainContentComponent()
-       : state (Stopped)
    {
-       juce::LookAndFeel::setDefaultLookAndFeel (&unixMatrixTheme);
+       StartupTrace::ScopedPhase phase ("MainContentComponent");
+
+       {
+           StartupTrace::ScopedPhase lnfPhase ("LookAndFeel");
+           juce::LookAndFeel::setDefaultLookAndFeel (&unixMatrixTheme);
+       }
 
        addAndMakeVisible (&openButton);
        openButton.setButtonText ("Open...");
        openButton.onClick = [this] { openButtonClicked(); };
+       openButton.setEnabled (false); // réactivé quand les formats sont enregistrés
+
+       addAndMakeVisible (&exportButton);
+       exportButton.setButtonText ("Export...");
+       exportButton.onClick = [this] { exportButtonClicked(); };
+       exportButton.setEnabled (false);
 
        addAndMakeVisible (&playButton);
        playButton.setButtonText ("Play");
@@ -154,7 +190,48 @@ public:
 
        addAndMakeVisible (&loopingToggle);
        loopingToggle.setButtonText ("Loop");
-       loopingToggle.onClick = [this] { loopButtonChanged(); };
+       loopingToggle.onClick = [this]
+       {
+           undoManager.beginNewTransaction();
+           loopButtonChanged();
+       };
+
+       addAndMakeVisible (&openGLToggle);
+       openGLToggle.setButtonText ("OpenGL meters");
+       openGLToggle.onClick = [this]
+       {
+           openGLToggle.setToggleState (glMeters.setEnabled (openGLToggle.getToggleState()), juce::dontSendNotification);
+           metersDirty = true;
+           animation.requestFrame();
+           repaint();
+       };
+
+       addAndMakeVisible (&dspToggle);
+       dspToggle.setButtonText ("EQ / Comp / Limiter");
+       dspToggle.onClick = [this]
+       {
+           undoManager.beginNewTransaction();
+           setPlayerProperty ("dsp", dspToggle.getToggleState());
+       };
+
+       addAndMakeVisible (&samplerToggle);
+       samplerToggle.setButtonText ("Sampler (MIDI notes)");
+       samplerToggle.onClick = [this] { samplerButtonChanged(); };
+
+       addAndMakeVisible (&recordToggle);
+       recordToggle.setButtonText ("Record input");
+       recordToggle.onClick = [this] { recordButtonChanged(); };
+
+       addAndMakeVisible (&insertsButton);
+       insertsButton.setButtonText ("Plug-in inserts...");
+       insertsButton.onClick = [this] { insertsButtonClicked(); };
+
+       glMeters.onFallback = [this]
+       {
+           openGLToggle.setToggleState (false, juce::dontSendNotification);
+           metersDirty = true;
+           repaint();
+       };
 
        addAndMakeVisible (&volumeSlider);
        volumeSlider.setRange (0.0, 1.0, 0.01);
@@ -163,94 +240,170 @@ public:
        volumeSlider.setTextBoxStyle (juce::Slider::NoTextBox, false, 0, 0);
        volumeSlider.onValueChange = [this]
        {
-           targetGain = (float) volumeSlider.getValue();
+           setPlayerProperty ("gain", volumeSlider.getValue());
        };
+       volumeSlider.onDragStart = [this] { undoManager.beginNewTransaction(); };
+
+       addAndMakeVisible (&panSlider);
+       panSlider.setRange (-1.0, 1.0, 0.01);
+       panSlider.setValue (0.0);
+       panSlider.setDoubleClickReturnValue (true, 0.0);
+       panSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+       panSlider.setTextBoxStyle (juce::Slider::NoTextBox, false, 0, 0);
+       panSlider.onValueChange = [this]
+       {
+           setPlayerProperty ("pan", panSlider.getValue());
+       };
+       panSlider.onDragStart = [this] { undoManager.beginNewTransaction(); };
+
+       addAndMakeVisible (&speedSlider);
+       speedSlider.setRange (0.5, 2.0, 0.01);
+       speedSlider.setSkewFactorFromMidPoint (1.0);
+       speedSlider.setValue (1.0);
+       speedSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+       speedSlider.setTextBoxStyle (juce::Slider::TextBoxRight, false, 50, 20);
+       speedSlider.setTextValueSuffix ("x");
+       speedSlider.onValueChange = [this]
+       {
+           setPlayerProperty ("speed", speedSlider.getValue());
+       };
+       speedSlider.onDragStart = [this] { undoManager.beginNewTransaction(); };
 
-       addAndMakeVisible (&currentPositionLabel);
-       currentPositionLabel.setText ("Stopped", juce::dontSendNotification);
-       currentPositionLabel.setFont (juce::Font (juce::FontOptions (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain)));
-       currentPositionLabel.setJustificationType (juce::Justification::centred);
+       // Un curseur de gain par bande du réglage par défaut de l'égaliseur
+       for (int band = 0; band < numEqSliders; ++band)
+       {
+           auto& slider = eqSliders[(size_t) band];
+           const auto frequency = PlaybackDSP::Settings().bands[(size_t) band].frequency;
+           const auto name = frequency >= 1000.0f ? juce::String (frequency / 1000.0f) + "k" : juce::String (frequency);
+
+           addAndMakeVisible (&slider);
+           slider.setRange (-12.0, 12.0, 0.5);
+           slider.setValue (0.0);
+           slider.setDoubleClickReturnValue (true, 0.0);
+           slider.setSliderStyle (juce::Slider::LinearBar);
+           slider.textFromValueFunction = [name] (double value) { return name + " " + juce::String (value, 1); };
+           slider.updateText();
+           slider.onValueChange = [this, band]
+           {
+               setPlayerProperty (getEqProperty (band), eqSliders[(size_t) band].getValue());
+           };
+           slider.onDragStart = [this] { undoManager.beginNewTransaction(); };
+       }
 
-       setSize (300, 200);
+       addAndMakeVisible (&stretchQualityBox);
+       stretchQualityBox.addItem ("Stretch: fast",   (int) TimeStretchSource::Quality::fast);
+       stretchQualityBox.addItem ("Stretch: normal", (int) TimeStretchSource::Quality::normal);
+       stretchQualityBox.addItem ("Stretch: high",   (int) TimeStretchSource::Quality::high);
+       stretchQualityBox.setSelectedId ((int) TimeStretchSource::Quality::normal, juce::dontSendNotification);
+       stretchQualityBox.onChange = [this]
+       {
+           engine.setStretchQuality ((TimeStretchSource::Quality) stretchQualityBox.getSelectedId());
+           playerState.setProperty ("stretchQuality", stretchQualityBox.getSelectedId(), nullptr);
+       };
 
-       formatManager.registerBasicFormats();
+       addAndMakeVisible (&positionBar);
+       positionBar.onSeek = [this] (double seconds)
+       {
+           engine.seek (seconds);
+           animation.requestFrame();
+       };
 
-       transportSource.addChangeListener (this);
+       addAndMakeVisible (&loudnessLabel);
+       loudnessLabel.setFont (juce::Font (juce::FontOptions (juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain)));
+       loudnessLabel.setJustificationType (juce::Justification::centred);
 
-       setAudioChannels (2, 2);
-       startTimer (50);
+       setSize (300, 545);
+       setWantsKeyboardFocus (true); // Cmd+Z / Cmd+Shift+Z
+
+       restoreSession();
+       engine.addListener (this);
+
+       remote.onLoad  = [this] (const juce::File& file) { return loadFile (file); };
+       remote.onPlay  = [this] { playButtonClicked(); };
+       remote.onPause = [this] { pauseButtonClicked(); };
+       remote.onStop  = [this] { stopButtonClicked(); };
+       remote.onSeek  = [this] (double seconds) { engine.seek (seconds); animation.requestFrame(); };
+       remote.onGain  = [this] (float gain) { volumeSlider.setValue (gain); };
+
+       controlInput.onGainChanged = [this] (float gain) { volumeSlider.setValue (gain); };
+       controlInput.onNotePlayed = [this]
+       {
+           lastNoteMs = juce::Time::getMillisecondCounterHiRes();
+           animation.setActive (true);
+       };
+       controlInput.setLatencyMeasurement (juce::JUCEApplicationBase::getCommandLineParameters().contains ("--measure-latency"));
+
+       {
+           // Device types must be created on the message thread (some of them
+           // own hidden windows), and AudioDeviceManager isn't thread-safe:
+           // the device is opened there too, see openAudioDevice().
+           StartupTrace::ScopedPhase typesPhase ("audio device types");
+           deviceManager.getAvailableDeviceTypes();
+       }
+
+       backgroundStartup->start();
+       animation.requestFrame();
    }
 
    ~MainContentComponent() override
    {
+       backgroundStartup.reset();
+       exportJob.reset(); // annule un export en cours avant que formatManager disparaisse
+       session.removeListener (this);
+       storePosition();
+       sessionStore.detach();
        juce::LookAndFeel::setDefaultLookAndFeel (nullptr);
        shutdownAudio();
+       engine.removeListener (this);
    }
 
    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
    {
-       transportSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
+       auto* device = deviceManager.getCurrentAudioDevice();
+       engine.setNumOutputChannels (device != nullptr ? device->getActiveOutputChannels().countNumberOfSetBits() : 2);
+
+       // Hardware output latency plus one buffer of queueing, for the control latency log
+       engine.setOutputLatency (device != nullptr ? device->getOutputLatencyInSamples() + samplesPerBlockExpected : 0, sampleRate);
+       engine.prepareToPlay (samplesPerBlockExpected, sampleRate);
+       recorder.prepare (device != nullptr ? device->getActiveInputChannels().countNumberOfSetBits() : 0, sampleRate);
    }
 
    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override
    {
-       if (readerSource.get() == nullptr)
-       {
-           bufferToFill.clearActiveBufferRegion();
-           return;
-       }
-
-       transportSource.getNextAudioBlock (bufferToFill);
-
-       if (auto* buffer = bufferToFill.buffer)
-       {
-           const auto gain = targetGain.get();
-           if (gain != 1.0f)
-               buffer->applyGain (bufferToFill.startSample, bufferToFill.numSamples, gain);
-       }
-
-       auto* buffer = bufferToFill.buffer;
-       if (buffer != nullptr && bufferToFill.numSamples > 0 && buffer->getNumChannels() > 0)
-       {
-           const int numChannels = buffer->getNumChannels();
-           const int startSample = bufferToFill.startSample;
-           const int numSamples  = bufferToFill.numSamples;
-
-           float maxSample = 0.0f;
-
-           for (int ch = 0; ch < numChannels; ++ch)
-           {
-               auto* data = buffer->getReadPointer (ch, startSample);
-               for (int i = 0; i < numSamples; ++i)
-               {
-                   auto s = std::abs (data[i]);
-                   if (s > maxSample)
-                       maxSample = s;
-               }
-           }
-
-           lastLevel = maxSample;
-       }
-       else
-       {
-           lastLevel = 0.0f;
-       }
+       // Les entrées arrivent dans le buffer, avant que le lecteur ne le remplisse
+       recorder.capture (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+       engine.getNextAudioBlock (bufferToFill);
    }
 
    void releaseResources() override
    {
-       transportSource.releaseResources();
+       engine.releaseResources();
    }
 
    void paint (juce::Graphics& g) override
    {
+       if (! firstPaintTraced)
+       {
+           firstPaintTraced = true;
+           StartupTrace::mark ("first paint");
+       }
+
+       // En mode OpenGL, le fond noir et les barres sont rendus par glMeters
+       // et ce paint() n'est plus qu'une couche posée par-dessus.
+       if (glMeters.isEnabled())
+       {
+           matrixBackground.drawCovering (g, getLocalBounds().withTrimmedBottom (meterHeight), 0.35f);
+           paintChannelMeters (g);
+           return;
+       }
+
        g.fillAll (juce::Colours::black); // fond terminal / Matrix
+       matrixBackground.drawCovering (g, getLocalBounds(), 0.35f);
+       paintChannelMeters (g);
 
-       auto bounds = getLocalBounds();
-       const int meterHeight = 40;
-       auto meterArea = bounds.removeFromBottom (meterHeight);
+       auto meterArea = getMeterArea();
 
-       g.setColour (juce::Colour::fromRGB (0, 255, 70)); // vert Matrix
+       g.setColour (meterColour);
 
        const int numBars = meterHistorySize;
        if (numBars > 0)
@@ -279,193 +432,652 @@ public:
        int y = margin;
 
        openButton.setBounds           (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       exportButton.setBounds         (margin, y, getWidth() - 2 * margin, h); y += h + gap;
        playButton.setBounds           (margin, y, getWidth() - 2 * margin, h); y += h + gap;
        pauseButton.setBounds          (margin, y, getWidth() - 2 * margin, h); y += h + gap;
        stopButton.setBounds           (margin, y, getWidth() - 2 * margin, h); y += h + gap;
        loopingToggle.setBounds        (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       openGLToggle.setBounds         (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       dspToggle.setBounds            (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       samplerToggle.setBounds        (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       recordToggle.setBounds         (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       insertsButton.setBounds        (margin, y, getWidth() - 2 * margin, h); y += h + gap;
        volumeSlider.setBounds         (margin, y, getWidth() - 2 * margin, h); y += h + gap;
-       currentPositionLabel.setBounds (margin, y, getWidth() - 2 * margin, h);
+       panSlider.setBounds            (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       speedSlider.setBounds          (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+
+       {
+           auto row = juce::Rectangle<int> (margin, y, getWidth() - 2 * margin, h);
+           const auto width = (row.getWidth() - (numEqSliders - 1) * gap) / numEqSliders;
+
+           for (auto& slider : eqSliders)
+           {
+               slider.setBounds (row.removeFromLeft (width));
+               row.removeFromLeft (gap);
+           }
+
+           y += h + gap;
+       }
+
+       stretchQualityBox.setBounds    (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       positionBar.setBounds          (margin, y, getWidth() - 2 * margin, h); y += h + gap;
+       loudnessLabel.setBounds        (margin, y, getWidth() - 2 * margin, h);
    }
 
-   void changeListenerCallback (juce::ChangeBroadcaster* source) override
+   void playerStateChanged (PlayerEngine::State newState) override
    {
-       if (source == &transportSource)
+       switch (newState)
        {
-           if (state == Paused)
-               return;
-
-           if (transportSource.isPlaying())
-               changeState (Playing);
-           else
-               changeState (Stopped);
+           case PlayerEngine::State::stopped:
+               stopButton.setEnabled (false);
+               playButton.setEnabled (! engine.isSamplerMode());
+               pauseButton.setEnabled (false);
+               break;
+
+           case PlayerEngine::State::starting:
+               playButton.setEnabled (false);
+               pauseButton.setEnabled (false);
+               break;
+
+           case PlayerEngine::State::playing:
+               stopButton.setEnabled (true);
+               pauseButton.setEnabled (true);
+               break;
+
+           case PlayerEngine::State::paused:
+               pauseButton.setEnabled (false);
+               playButton.setEnabled (true);
+               stopButton.setEnabled (true);
+               break;
+
+           case PlayerEngine::State::stopping:
+               break;
        }
+
+       animation.requestFrame();
    }
 
-   void timerCallback() override
+   void animationFrame (double nowMs)
    {
+       // L'historique avance toujours par pas de 50 ms, quelle que soit la
+       // fréquence de l'écran ; après une longue pause on repart de zéro.
+       if (nowMs - lastMeterStepMs > meterStepMs * meterHistorySize)
+           lastMeterStepMs = nowMs - meterStepMs;
+
+       while (nowMs - lastMeterStepMs >= meterStepMs)
        {
-           const auto level = lastLevel.get();
+           lastMeterStepMs += meterStepMs;
+
+           const auto level = engine.getLevel();
+           metersDirty = metersDirty || level != 0.0f || meterLevels[meterWriteIndex] != 0.0f || numActiveMeters > 0;
+           numActiveMeters += (level != 0.0f ? 1 : 0) - (meterLevels[meterWriteIndex] != 0.0f ? 1 : 0);
+
            meterLevels[meterWriteIndex] = level;
            meterWriteIndex = (meterWriteIndex + 1) % meterHistorySize;
        }
 
-       repaint();
+       updateChannelMeters();
 
-       if (transportSource.isPlaying())
+       if (metersDirty)
        {
-           juce::RelativeTime position (transportSource.getCurrentPosition());
+           metersDirty = false;
 
-           auto minutes = ((int) position.inMinutes()) % 60;
-           auto seconds = ((int) position.inSeconds()) % 60;
-           auto millis  = ((int) position.inMilliseconds()) % 1000;
+           if (glMeters.isEnabled())
+               glMeters.setBars (meterLevels, meterHistorySize, meterWriteIndex, getMeterArea(), meterColour);
+           else
+               repaint (getMeterArea());
+       }
 
-           auto positionString = juce::String::formatted ("%02d:%02d:%03d", minutes, seconds, millis);
+       updatePositionBar();
+       updateLoudnessLabel();
 
-           currentPositionLabel.setText (positionString, juce::dontSendNotification);
-       }
-       else
+       const auto samplerSounding = engine.isSamplerMode() && engine.getNumActiveVoices() > 0;
+
+       if ((engine.isPlaying() || samplerSounding) && nowMs - lastLoadReportMs >= 5000.0)
        {
-           if (state == Paused)
-               currentPositionLabel.setText ("Paused", juce::dontSendNotification);
-           else
-               currentPositionLabel.setText ("Stopped", juce::dontSendNotification);
+           lastLoadReportMs = nowMs;
+           engine.logProcessingLoad();
        }
+
+       // Plus rien ne bouge : on rend la main, zéro réveil jusqu'au prochain Play ou
+       // la prochaine note (laissée 250 ms au thread audio pour démarrer sa voix)
+       const auto noteJustPlayed = nowMs - lastNoteMs < 250.0;
+       animation.setActive (engine.isPlaying() || samplerSounding || noteJustPlayed || positionBar.isSeeking()
+                             || numActiveMeters > 0 || numActiveChannelMeters > 0);
+   }
+
+   void updateLoudnessLabel()
+   {
+       const auto r = engine.getLoudnessMeter().getReadings();
+
+       const auto lufs = [] (float v) { return std::isfinite (v) ? juce::String (v, 1) : juce::String ("-inf"); };
+
+       loudnessLabel.setText ("M " + lufs (r.momentary) + "  S " + lufs (r.shortTerm)
+                                + "  I " + lufs (r.integrated) + " LUFS  LRA " + juce::String (r.range, 1)
+                                + "  TP " + lufs (r.truePeak),
+                              juce::dontSendNotification);
+   }
+
+   void updatePositionBar()
+   {
+       const char* status = nullptr;
+
+       if (! engine.isPlaying())
+           status = engine.getState() == PlayerEngine::State::paused ? "Paused" : "Stopped";
+
+       positionBar.update (engine.getCurrentPosition(), engine.getLengthInSeconds(), status);
    }
 
    void updateLoopState (bool shouldLoop)
    {
-       if (readerSource.get() != nullptr)
-           readerSource->setLooping (shouldLoop);
+       engine.setLooping (shouldLoop);
+   }
+
+   bool keyPressed (const juce::KeyPress& key) override
+   {
+       const auto command = key.getModifiers().isCommandDown();
+
+       if (command && key.getKeyCode() == 'Z' && ! key.getModifiers().isShiftDown())
+           return undoManager.undo();
+
+       if (command && (key.getKeyCode() == 'Y' || (key.getKeyCode() == 'Z' && key.getModifiers().isShiftDown())))
+           return undoManager.redo();
+
+       if (! command && engine.hasFile() && ! engine.isSamplerMode())
+           return editClipAtPlayhead (key.getTextCharacter());
+
+       return false;
    }
 
 private:
    static constexpr int meterHistorySize = 64;
+   static constexpr int meterHeight = 40;
+   static constexpr double meterStepMs = 50.0;
+   double lastMeterStepMs = 0.0;
+   int numActiveMeters = 0;   // barres non nulles dans l'historique
+   bool metersDirty = true;
+   double lastLoadReportMs = 0.0;
+   double lastNoteMs = 0.0;
+
+   const juce::Colour meterColour { juce::Colour::fromRGB (0, 255, 70) }; // vert Matrix
    float meterLevels[meterHistorySize] = {};
    int meterWriteIndex = 0;
-   juce::Atomic<float> lastLevel { 0.0f };
-   juce::Atomic<float> targetGain { 1.0f };
 
    UnixMatrixLookAndFeel unixMatrixTheme;
+   OpenGLMeterRenderer glMeters { *this };
+   AnimationScheduler animation { *this, [this] (double nowMs) { animationFrame (nowMs); } };
+
+   juce::Rectangle<int> getMeterArea() const
+   {
+       return getLocalBounds().removeFromBottom (meterHeight);
+   }
+
+   //==========================================================================
+   // Une barre horizontale fine par sortie, juste au-dessus de l'historique
+   static constexpr int channelMeterHeight = 12;
+   std::array<float, ChannelRouter::maxChannels> channelMeterLevels {};
+   int numActiveChannelMeters = 0;
+
+   juce::Rectangle<int> getChannelMeterArea() const
+   {
+       return getLocalBounds().withTrimmedBottom (meterHeight).removeFromBottom (channelMeterHeight).reduced (10, 2);
+   }
+
+   void updateChannelMeters()
+   {
+       bool changed = false;
+       numActiveChannelMeters = 0;
+
+       for (int ch = 0; ch < engine.getNumOutputChannels(); ++ch)
+       {
+           auto& shown = channelMeterLevels[(size_t) ch];
+           const auto peak = engine.takeChannelPeak (ch);
+           auto level = juce::jmax (peak, shown * 0.85f);
+
+           if (level < 0.001f)
+               level = 0.0f;
+
+           changed = changed || level != shown;
+           shown = level;
+           numActiveChannelMeters += level > 0.0f ? 1 : 0;
+       }
+
+       if (changed)
+           repaint (getChannelMeterArea());
+   }
+
+   void paintChannelMeters (juce::Graphics& g) const
+   {
+       const auto area = getChannelMeterArea();
+       const int num = engine.getNumOutputChannels();
+
+       if (num <= 0 || area.isEmpty())
+           return;
 
-   enum TransportState
+       // Tous les canaux en un seul remplissage
+       juce::RectangleList<float> bars;
+       const auto slotHeight = (float) area.getHeight() / (float) num;
+
+       for (int ch = 0; ch < num; ++ch)
+       {
+           const auto level = juce::jlimit (0.0f, 1.0f, channelMeterLevels[(size_t) ch]);
+
+           if (level > 0.0f)
+               bars.addWithoutMerging ({ (float) area.getX(), (float) area.getY() + slotHeight * (float) ch,
+                                         (float) area.getWidth() * level, juce::jmax (1.0f, slotHeight - 0.5f) });
+       }
+
+       g.setColour (meterColour.withAlpha (0.8f));
+       g.fillRectList (bars);
+   }
+   ImageAssetCache matrixBackground { "UnixMatrix.png", [this] { repaint(); } };
+
+   // Tout ce qui est lent au démarrage tourne ici, hors du chemin critique
+   void runDeferredStartup()
    {
-       Stopped,
-       Starting,
-       Playing,
-       Paused,
-       Stopping
-   };
+       {
+           StartupTrace::ScopedPhase formatsPhase ("registerBasicFormats");
+           formatManager.registerBasicFormats();
+       }
+
+       juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<MainContentComponent> (this)]
+       {
+           if (safeThis != nullptr)
+           {
+               safeThis->openButton.setEnabled (true);
+               safeThis->remote.start(); // une commande load lit les formats : pas avant
+               safeThis->restoreSessionFile();
+           }
+       });
+
+       {
+           StartupTrace::ScopedPhase controlPhase ("MIDI / OSC inputs");
+           controlInput.start();
+       }
 
-   void changeState (TransportState newState)
+       // Le deviceManager n'est touché que depuis le thread des messages
+       juce::MessageManager::callAsync ([safeThis = juce::Component::SafePointer<MainContentComponent> (this)]
+       {
+           if (safeThis != nullptr)
+               safeThis->openAudioDevice();
+       });
+
+       // Le scan tourne dans des processus fils, sur un thread de basse priorité
+       plugins.startScan();
+   }
+
+   void openAudioDevice()
    {
-       if (state != newState)
+       StartupTrace::ScopedPhase devicePhase ("audio device open");
+       setAudioChannels (2, 2);
+
+       // Ouvre toutes les sorties de la carte (jusqu'à 64), pas seulement deux
+       if (auto* device = deviceManager.getCurrentAudioDevice())
        {
-           state = newState;
+           const auto available = juce::jmin (ChannelRouter::maxChannels, device->getOutputChannelNames().size());
 
-           switch (state)
+           if (available > 2)
            {
-               case Stopped:
-                   stopButton.setEnabled (false);
-                   playButton.setEnabled (true);
-                   pauseButton.setEnabled (false);
-                   transportSource.setPosition (0.0);
-                   break;
-
-               case Starting:
-                   playButton.setEnabled (false);
-                   pauseButton.setEnabled (false);
-                   transportSource.start();
-                   break;
-
-               case Playing:
-                   stopButton.setEnabled (true);
-                   pauseButton.setEnabled (true);
-                   break;
-
-               case Paused:
-                   pauseButton.setEnabled (false);
-                   playButton.setEnabled (true);
-                   stopButton.setEnabled (true);
-                   break;
-
-               case Stopping:
-                   transportSource.stop();
-                   break;
+               auto setup = deviceManager.getAudioDeviceSetup();
+               setup.useDefaultOutputChannels = false;
+               setup.outputChannels.clear();
+               setup.outputChannels.setRange (0, available, true);
+               deviceManager.setAudioDeviceSetup (setup, true);
            }
        }
    }
 
+   // Les réglages reviennent tout de suite ; le fichier attend que les formats soient là
+   void restoreSession()
+   {
+       if (auto saved = sessionStore.load(); saved.isValid())
+           session = saved;
+
+       playerState = session.getOrCreateChildWithName ("PLAYER", nullptr);
+
+       for (auto id : { "gain", "pan", "speed", "looping", "dsp" })
+           applyPlayerProperty (id);
+
+       for (int band = 0; band < numEqSliders; ++band)
+           applyPlayerProperty (getEqProperty (band));
+
+       stretchQualityBox.setSelectedId (playerState.getProperty ("stretchQuality", stretchQualityBox.getSelectedId()),
+                                        juce::sendNotificationSync);
+
+       session.addListener (this);
+       sessionStore.attach (session);
+   }
+
+   // Les réglages passent par l'historique : chaque glisser ou clic ouvre une étape,
+   // le reste (clavier, télécommande, MIDI) s'ajoute à l'étape en cours
+   void setPlayerProperty (const juce::Identifier& id, const juce::var& value)
+   {
+       playerState.setProperty (id, value, &undoManager);
+   }
+
+   // Modification, annulation ou rétablissement : le moteur suit l'arbre, sans verrou
+   void valueTreePropertyChanged (juce::ValueTree& node, const juce::Identifier& id) override
+   {
+       if (node == playerState)
+           applyPlayerProperty (id);
+   }
+
+   void applyPlayerProperty (const juce::Identifier& id)
+   {
+       if (id == juce::Identifier ("gain"))
+       {
+           const auto gain = (double) playerState.getProperty (id, 1.0);
+           engine.setGain ((float) gain);
+           volumeSlider.setValue (gain, juce::dontSendNotification);
+       }
+       else if (id == juce::Identifier ("pan"))
+       {
+           const auto pan = (double) playerState.getProperty (id, 0.0);
+           engine.setPan ((float) pan);
+           panSlider.setValue (pan, juce::dontSendNotification);
+       }
+       else if (id == juce::Identifier ("speed"))
+       {
+           const auto speed = (double) playerState.getProperty (id, 1.0);
+           engine.setSpeed (speed);
+           speedSlider.setValue (speed, juce::dontSendNotification);
+       }
+       else if (id == juce::Identifier ("looping"))
+       {
+           updateLoopState (playerState[id]);
+           loopingToggle.setToggleState (playerState[id], juce::dontSendNotification);
+       }
+       else if (id == juce::Identifier ("dsp"))
+       {
+           engine.getDSPChain().setEnabled (playerState[id]);
+           dspToggle.setToggleState (playerState[id], juce::dontSendNotification);
+       }
+       else
+       {
+           for (int band = 0; band < numEqSliders; ++band)
+           {
+               if (id != getEqProperty (band))
+                   continue;
+
+               // Les coefficients sont calculés ici et passent au thread audio sans verrou
+               const auto gainDecibels = (double) playerState.getProperty (id, 0.0);
+               auto settings = engine.getDSPChain().getSettings();
+               settings.bands[(size_t) band].gainDecibels = (float) gainDecibels;
+               engine.getDSPChain().setSettings (settings);
+               eqSliders[(size_t) band].setValue (gainDecibels, juce::dontSendNotification);
+           }
+       }
+   }
+
+   static juce::Identifier getEqProperty (int band)
+   {
+       return "eq" + juce::String (band);
+   }
+
+   void restoreSessionFile()
+   {
+       const auto path = playerState["file"].toString();
+       const auto position = (double) playerState["position"];
+
+       if (! juce::File::isAbsolutePath (path) || ! juce::File (path).exists() || ! loadFile (juce::File (path)))
+           return;
+
+       if ((bool) playerState["sampler"] && ! samplerToggle.getToggleState())
+           samplerToggle.setToggleState (true, juce::sendNotification);
+
+       engine.seek (position);
+       animation.requestFrame();
+   }
+
+   // Montage non destructif à la tête de lecture : S coupe, [ et ] rognent, F pose des fondus de 50 ms.
+   // Un rognage qui viderait le clip (tête de lecture au début ou à la fin) est refusé.
+   bool editClipAtPlayhead (juce::juce_wchar key)
+   {
+       auto& clip = engine.getClipEditor();
+       const auto playhead = (juce::int64) (engine.getCurrentPosition() * clip.getSampleRate());
+
+       switch (key)
+       {
+           case 's': case 'S':     clip.split (playhead); break;
+           case ']':               clip.trim (0, playhead); break;
+           case '[':               if (clip.trim (playhead, clip.getEdits()->getLength())) engine.seek (0.0); break;
+           case 'f': case 'F':     clip.setFades (playhead, (int) (0.05 * clip.getSampleRate()), (int) (0.05 * clip.getSampleRate())); break;
+           default:                return false;
+       }
+
+       animation.requestFrame();
+       return true;
+   }
+
+   void storePosition()
+   {
+       if (engine.hasFile())
+           playerState.setProperty ("position", engine.getCurrentPosition(), nullptr);
+   }
+
    void openButtonClicked()
    {
        auto wildcard = formatManager.getWildcardForAllFormats();
 
-       chooser = std::make_unique<juce::FileChooser> ("Select an audio file to play...",
+       chooser = std::make_unique<juce::FileChooser> ("Select an audio file to play, or a folder of samples...",
                                                       juce::File{},
                                                       wildcard);
        auto chooserFlags = juce::FileBrowserComponent::openMode
-                         | juce::FileBrowserComponent::canSelectFiles;
+                         | juce::FileBrowserComponent::canSelectFiles
+                         | juce::FileBrowserComponent::canSelectDirectories;
 
        chooser->launchAsync (chooserFlags, [this] (const juce::FileChooser& fc)
        {
            auto file = fc.getResult();
 
            if (file != juce::File{})
-           {
-               auto* reader = formatManager.createReaderFor (file);
-
-               if (reader != nullptr)
-               {
-                   auto newSource = std::make_unique<juce::AudioFormatReaderSource> (reader, true);
-                   transportSource.setSource (newSource.get(), 0, nullptr, reader->sampleRate);
-                   playButton.setEnabled (true);
-                   pauseButton.setEnabled (false);
-                   stopButton.setEnabled (false);
-                   readerSource.reset (newSource.release());
-               }
-           }
+               loadFile (file);
+       });
+   }
+
+   bool loadFile (const juce::File& file)
+   {
+       // Un dossier = une banque multi-échantillons, jouée en streaming au clavier MIDI
+       if (file.isDirectory())
+       {
+           engine.loadLibrary (file);
+           samplerToggle.setToggleState (true, juce::dontSendNotification);
+           playerState.setProperty ("file", file.getFullPathName(), nullptr)
+                      .setProperty ("sampler", true, nullptr);
+           playButton.setEnabled (false);
+           animation.requestFrame();
+           return true;
+       }
+
+       if (! engine.loadFile (file))
+           return false;
+
+       playerState.setProperty ("file", file.getFullPathName(), nullptr)
+                  .setProperty ("position", 0.0, nullptr);
+       playButton.setEnabled (! engine.isSamplerMode());
+       pauseButton.setEnabled (false);
+       stopButton.setEnabled (false);
+       exportButton.setEnabled (true);
+       return true;
+   }
+
+   void exportButtonClicked()
+   {
+       if (exportJob != nullptr && exportJob->isThreadRunning())
+           return;
+
+       chooser = std::make_unique<juce::FileChooser> ("Export the processed output as...",
+                                                      engine.getCurrentFile().withFileExtension ("wav"),
+                                                      ExportJob::getWildcard());
+       auto chooserFlags = juce::FileBrowserComponent::saveMode
+                         | juce::FileBrowserComponent::warnAboutOverwriting;
+
+       chooser->launchAsync (chooserFlags, [this] (const juce::FileChooser& fc)
+       {
+           auto destination = fc.getResult();
+
+           if (destination == juce::File{})
+               return;
+
+           if (! destination.hasFileExtension (ExportJob::getWildcard().removeCharacters ("*.")))
+               destination = destination.withFileExtension ("wav");
+
+           ExportJob::Options options;
+           options.source      = engine.getCurrentFile();
+           options.destination = destination;
+           options.gain        = engine.getGain();
+           options.pan         = engine.getPan();
+           options.dspEnabled  = engine.getDSPChain().isEnabled();
+           options.dspSettings = engine.getDSPChain().getSettings();
+
+           exportJob = std::make_unique<ExportJob> (formatManager, std::move (options), this);
+           exportJob->launchThread();
        });
    }
 
    void playButtonClicked()
    {
        updateLoopState (loopingToggle.getToggleState());
-       changeState (Starting);
+       engine.play();
        pauseButton.setEnabled (true);
    }
 
    void stopButtonClicked()
    {
-       transportSource.stop();
-       transportSource.setPosition (0.0);
-       changeState (Stopped);
+       engine.stop();
+       playerState.setProperty ("position", 0.0, nullptr);
    }
 
    void pauseButtonClicked()
    {
-       transportSource.stop();
-       changeState (Paused);
+       engine.pause();
+       storePosition();
    }
 
    void loopButtonChanged()
    {
-       updateLoopState (loopingToggle.getToggleState());
+       setPlayerProperty ("looping", loopingToggle.getToggleState());
+   }
+
+   // En mode sampler le fichier se joue au clavier MIDI, le transport est coupé
+   void samplerButtonChanged()
+   {
+       const auto useSampler = samplerToggle.getToggleState();
+       engine.setSamplerMode (useSampler);
+       playerState.setProperty ("sampler", useSampler, nullptr);
+       playButton.setEnabled (! useSampler && engine.hasFile());
+       animation.requestFrame();
+   }
+
+   // Une prise par clic, avec les secondes d'avant (pré-roll), dans ~/Music/UnixMatrix Recordings
+   void recordButtonChanged()
+   {
+       if (! recordToggle.getToggleState())
+       {
+           recorder.stopRecording();
+           return;
+       }
+
+       const auto take = juce::File::getSpecialLocation (juce::File::userMusicDirectory)
+                           .getChildFile ("UnixMatrix Recordings")
+                           .getChildFile ("Take " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H%M%S") + ".wav");
+
+       if (const auto result = recorder.startRecording (take); result.failed())
+       {
+           recordToggle.setToggleState (false, juce::dontSendNotification);
+           juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon, "Record",
+                                                   result.getErrorMessage());
+       }
+   }
+
+   // Un sous-menu par branche parallèle ; chaque plug-in s'ajoute en fin de branche
+   void insertsButtonClicked()
+   {
+       auto& inserts = engine.getInsertChain();
+       const auto types = plugins.getKnownPlugins().getTypes();
+       juce::PopupMenu menu;
+
+       for (int branch = 0; branch < InsertChain::maxBranches; ++branch)
+       {
+           juce::PopupMenu branchMenu;
+
+           for (const auto& type : types)
+               if (! type.isInstrument)
+                   branchMenu.addItem (type.name + " (" + type.pluginFormatName + ")",
+                                       [this, branch, type] { addInsert (branch, type); });
+
+           menu.addSubMenu (juce::String::formatted ("Branch %d (%d plug-in(s))", branch + 1, inserts.getNumPlugins (branch)),
+                            branchMenu, ! types.isEmpty());
+       }
+
+       menu.addSeparator();
+       menu.addItem ("Log CPU per plug-in", inserts.getNumBranches() > 0, false, [this] { engine.getInsertChain().logProcessingLoad(); });
+       menu.addItem ("Remove all inserts", inserts.getNumBranches() > 0, false, [this] { engine.getInsertChain().clear(); });
+       menu.addItem (plugins.isScanning() ? "Scanning plug-ins..." : "Rescan plug-ins", ! plugins.isScanning(), false,
+                     [this] { plugins.startScan(); });
+
+       menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (insertsButton));
+   }
+
+   void addInsert (int branch, const juce::PluginDescription& type)
+   {
+       auto* device = deviceManager.getCurrentAudioDevice();
+       const auto sampleRate = device != nullptr ? device->getCurrentSampleRate() : 44100.0;
+       const auto blockSize  = device != nullptr ? device->getCurrentBufferSizeSamples() : 512;
+
+       plugins.getFormatManager().createPluginInstanceAsync (type, sampleRate, blockSize,
+           [safeThis = juce::Component::SafePointer<MainContentComponent> (this), branch] (std::unique_ptr<juce::AudioPluginInstance> instance,
+                                                                                          const juce::String& error)
+           {
+               if (safeThis == nullptr)
+                   return;
+
+               if (instance == nullptr)
+                   juce::Logger::writeToLog ("[insert] " + error);
+               else
+                   safeThis->engine.getInsertChain().addPlugin (branch, std::move (instance));
+           });
    }
 
    //==========================================================================
    juce::TextButton openButton;
+   juce::TextButton exportButton;
    juce::TextButton playButton;
    juce::TextButton pauseButton;
    juce::TextButton stopButton;
    juce::ToggleButton loopingToggle;
+   juce::ToggleButton openGLToggle;
+   juce::ToggleButton dspToggle;
+   juce::ToggleButton samplerToggle;
+   juce::ToggleButton recordToggle;
+   juce::TextButton insertsButton;
    juce::Slider volumeSlider;
-   juce::Label currentPositionLabel;
+   juce::Slider panSlider;
+   juce::Slider speedSlider;
+   static constexpr int numEqSliders = 4;
+   std::array<juce::Slider, numEqSliders> eqSliders;
+   juce::ComboBox stretchQualityBox;
+   SeekBar positionBar;
+   juce::Label loudnessLabel;
 
    std::unique_ptr<juce::FileChooser> chooser;
 
    juce::AudioFormatManager formatManager;
-   std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
-   juce::AudioTransportSource transportSource;
-   TransportState state;
+   PluginCatalogue plugins; // outlives the engine, which holds the plug-in instances
+   PlayerEngine engine { formatManager };
+   RemoteControlServer remote { engine };
+   ControlInput controlInput { engine };
+   InputRecorder recorder { formatManager };
+   std::unique_ptr<ExportJob> exportJob;
+
+   juce::ValueTree session { "SESSION" };
+   juce::ValueTree playerState;    // session/PLAYER: fichier, position et réglages
+   SessionStore sessionStore { SessionStore::getDefaultFile() };
+
+   juce::UndoManager undoManager;
+
+   bool firstPaintTraced = false;
+   std::unique_ptr<BackgroundStartup> backgroundStartup { std::make_unique<BackgroundStartup> ([this] { runDeferredStartup(); }) };
 
    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainContentComponent)
 };
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+   Windows95LookAndFeel.h
+
+   The Windows 95 skin's LookAndFeel: grey bevelled buttons and checkboxes.
+   Shared by the Windows95feel PIP and DrawProfiler, which times it without
+   pulling in the PIP's player.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ButtonSkinCache.h"
+
+class Windows95LookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    Windows95LookAndFeel()
+    {
+        using namespace juce;
+
+        // Fond global façon Windows 95
+        setColour (ResizableWindow::backgroundColourId, background);
+
+        // Boutons
+        setColour (TextButton::buttonColourId,          background);
+        setColour (TextButton::buttonOnColourId,        background);
+        setColour (TextButton::textColourOnId,          textColour);
+        setColour (TextButton::textColourOffId,         textColour);
+
+        // Labels
+        setColour (Label::textColourId,                 textColour);
+        setColour (Label::backgroundColourId,           Colours::transparentBlack);
+
+        // ToggleButton
+        setColour (ToggleButton::textColourId,          textColour);
+
+        // Sliders
+        setColour (Slider::backgroundColourId,          background);
+        setColour (Slider::thumbColourId,               darkShadow);
+        setColour (Slider::trackColourId,               darkShadow);
+        setColour (Slider::textBoxTextColourId,         textColour);
+
+        // Scrollbars
+        setColour (ScrollBar::thumbColourId,            darkShadow);
+    }
+
+    juce::Font getTextButtonFont (juce::TextButton&, int height) override
+    {
+        return juce::Font ((float) juce::jmin (height - 4, 14), juce::Font::plain);
+    }
+
+    juce::Font getLabelFont (juce::Label&) override
+    {
+        return juce::Font (12.0f, juce::Font::plain);
+    }
+
+    void drawButtonBackground (juce::Graphics& g,
+                               juce::Button& button,
+                               const juce::Colour& backgroundColour,
+                               bool isHovered,
+                               bool isDown) override
+    {
+        buttonSkin.draw (g, button.getLocalBounds(), backgroundColour,
+                         ButtonSkinCache::getState (button, isHovered, isDown));
+    }
+
+private:
+    // Tracé vectoriel, rastérisé une fois par couleur / état / échelle
+    void paintButtonSkin (juce::Graphics& g, juce::Rectangle<float> bounds,
+                          juce::Colour backgroundColour, ButtonSkinCache::State state)
+    {
+        auto base = backgroundColour;
+
+        if (state == ButtonSkinCache::State::down)
+            base = base.darker (0.2f);
+        else if (state == ButtonSkinCache::State::hover)
+            base = base.brighter (0.1f);
+
+        g.setColour (base);
+        g.fillRect (bounds);
+
+        g.setColour (darkShadow);
+        g.drawRect (bounds, 1.0f);
+    }
+
+    // Palette Win95 basique
+    juce::Colour background { juce::Colour::fromRGB (192, 192, 192) }; // #C0C0C0
+    juce::Colour darkShadow { juce::Colour::fromRGB (128, 128, 128) }; // #808080
+    juce::Colour lightEdge  { juce::Colours::white };
+    juce::Colour textColour { juce::Colours::black };
+
+    ButtonSkinCache buttonSkin { 2, [this] (auto& g, auto bounds, auto colour, auto state)
+                                    { paintButtonSkin (g, bounds, colour, state); } };
+};
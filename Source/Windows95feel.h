@@ -47,82 +47,12 @@
 
 #pragma once
 
-class Windows95LookAndFeel : public juce::LookAndFeel_V4
-{
-public:
-    Windows95LookAndFeel()
-    {
-        using namespace juce;
-
-        // Fond global façon Windows 95
-        setColour (ResizableWindow::backgroundColourId, background);
-
-        // Boutons
-        setColour (TextButton::buttonColourId,          background);
-        setColour (TextButton::buttonOnColourId,        background);
-        setColour (TextButton::textColourOnId,          textColour);
-        setColour (TextButton::textColourOffId,         textColour);
-
-        // Labels
-        setColour (Label::textColourId,                 textColour);
-        setColour (Label::backgroundColourId,           Colours::transparentBlack);
-
-        // ToggleButton
-        setColour (ToggleButton::textColourId,          textColour);
-
-        // Sliders
-        setColour (Slider::backgroundColourId,          background);
-        setColour (Slider::thumbColourId,               darkShadow);
-        setColour (Slider::trackColourId,               darkShadow);
-        setColour (Slider::textBoxTextColourId,         textColour);
-
-        // Scrollbars
-        setColour (ScrollBar::thumbColourId,            darkShadow);
-    }
-
-    juce::Font getTextButtonFont (juce::TextButton&, int height) override
-    {
-        return juce::Font ((float) juce::jmin (height - 4, 14), juce::Font::plain);
-    }
-
-    juce::Font getLabelFont (juce::Label&) override
-    {
-        return juce::Font (12.0f, juce::Font::plain);
-    }
-
-    void drawButtonBackground (juce::Graphics& g,
-                               juce::Button& button,
-                               const juce::Colour& backgroundColour,
-                               bool isHovered,
-                               bool isDown) override
-    {
-        auto bounds = button.getLocalBounds().toFloat();
-        auto base   = backgroundColour;
-
-        if (isDown)
-            base = base.darker (0.2f);
-        else if (isHovered)
-            base = base.brighter (0.1f);
-
-        g.setColour (base);
-        g.fillRect (bounds);
-
-        g.setColour (darkShadow);
-        g.drawRect (bounds, 1.0f);
-    }
-
-private:
-    // Palette Win95 basique
-    juce::Colour background { juce::Colour::fromRGB (192, 192, 192) }; // #C0C0C0
-    juce::Colour darkShadow { juce::Colour::fromRGB (128, 128, 128) }; // #808080
-    juce::Colour lightEdge  { juce::Colours::white };
-    juce::Colour textColour { juce::Colours::black };
-};
+#include "AnimationScheduler.h"
+#include "Windows95LookAndFeel.h"
 
 //==============================================================================
 class MainContentComponent   : public juce::AudioAppComponent,
-                               public juce::ChangeListener,
-                               public juce::Timer
+                               public juce::ChangeListener
 {
 public:
     MainContentComponent()
@@ -164,7 +94,7 @@ public:
         transportSource.addChangeListener (this);
 
         setAudioChannels (2, 2);
-        startTimer (50);
+        animation.requestFrame();
     }
 
     ~MainContentComponent() override
@@ -228,7 +158,7 @@ public:
         }
     }
 
-    void timerCallback() override
+    void animationFrame (double)
     {
         if (transportSource.isPlaying())
         {
@@ -249,6 +179,8 @@ public:
             else
                 currentPositionLabel.setText ("Stopped", juce::dontSendNotification);
         }
+
+        animation.setActive (transportSource.isPlaying());
     }
 
     void updateLoopState (bool shouldLoop)
@@ -259,6 +191,7 @@ public:
 
 private:
     Windows95LookAndFeel windows95Theme;
+    AnimationScheduler animation { *this, [this] (double nowMs) { animationFrame (nowMs); } };
 
     enum TransportState
     {
@@ -305,6 +238,8 @@ private:
                     transportSource.stop();
                     break;
             }
+
+            animation.requestFrame();
         }
     }
 